@@ -0,0 +1,54 @@
+# cmake -DNM=<nm> -DOBJECTS=<a.o|b.o|...> -P checkIsaSymbols.cmake
+#
+# OBJECTS are in link order. Linkers keep the first copy of a weak symbol (inline functions, template instances),
+# so a symbol that a baseline object defines must not be defined earlier by an object built for a wider ISA,
+# and an AVX2 object must not come after an AVX-512 one that defines the same symbol.
+# The ISA level of an object comes from its source name: *AVX512.cc, *AVX2.cc or anything else for the baseline.
+
+string(REPLACE "|" ";" OBJECTS "${OBJECTS}")
+
+set(ERRORS "")
+
+foreach(OBJ IN LISTS OBJECTS)
+    if (OBJ MATCHES "AVX512\\.[^/]*$")
+        set(LEVEL 2)
+    elseif (OBJ MATCHES "AVX2\\.[^/]*$")
+        set(LEVEL 1)
+    else()
+        set(LEVEL 0)
+    endif()
+
+    execute_process(
+        COMMAND ${NM} -P --defined-only ${OBJ}
+        OUTPUT_VARIABLE NM_OUTPUT
+        RESULT_VARIABLE NM_RESULT
+    )
+    if (NOT NM_RESULT EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on '${OBJ}'")
+    endif()
+
+    # "name type value size", W/V are weak functions and objects, u is gnu unique
+    string(REGEX MATCHALL "[^ \n]+ [WVu]" WEAK_SYMBOLS "${NM_OUTPUT}")
+
+    foreach(ENTRY IN LISTS WEAK_SYMBOLS)
+        string(REGEX REPLACE " [WVu]$" "" SYM "${ENTRY}")
+
+        # personality routine pointer, data only
+        if (SYM MATCHES "^DW\\.ref\\.")
+            continue()
+        endif()
+
+        if (NOT DEFINED FIRST_LEVEL_${SYM})
+            set(FIRST_LEVEL_${SYM} ${LEVEL})
+            set(FIRST_OBJ_${SYM} ${OBJ})
+        elseif (LEVEL LESS FIRST_LEVEL_${SYM})
+            string(APPEND ERRORS "  ${SYM}: first defined by '${FIRST_OBJ_${SYM}}', but '${OBJ}' is built for a lower ISA level\n")
+            # report each symbol once
+            set(FIRST_LEVEL_${SYM} ${LEVEL})
+        endif()
+    endforeach()
+endforeach()
+
+if (ERRORS)
+    message(FATAL_ERROR "weak symbols would be linked from a wider ISA than their callers:\n${ERRORS}")
+endif()
@@ -8,7 +8,7 @@
  * <nmmintrin.h> SSE4.2
  * <ammintrin.h> SSE4A
  * <wmmintrin.h> AES
- * <immintrin.h> AVX, AVX2, FMA
+ * <immintrin.h> AVX, AVX2, FMA, AVX-512
  */
 
 #pragma once
@@ -18,13 +18,35 @@
 
 #include <nmmintrin.h>
 
-#if defined ADT_AVX2
+#if defined ADT_AVX2 || defined ADT_AVX512
+    /* gcc 12 warns about the deliberately undefined vectors inside of avx512 intrinsics (gcc bug 105593) */
+    #if defined __GNUC__ && !defined __clang__
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wuninitialized"
+        #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    #endif
+
     #include <immintrin.h>
+
+    #if defined __GNUC__ && !defined __clang__
+        #pragma GCC diagnostic pop
+    #endif
 #endif
 
 namespace adt::simd
 {
 
+/* Every ISA level mangles its own copies of these, so that out-of-line helpers from a
+ * translation unit built with -mavx2 or -mavx512* never stand in for the baseline ones at link time. */
+#if defined ADT_AVX512
+inline namespace avx512
+#elif defined ADT_AVX2
+inline namespace avx2
+#else
+inline namespace baseline
+#endif
+{
+
 /* 128 bit */
 
 struct f32x4;
@@ -83,6 +105,14 @@ struct f32x4
     explicit operator math::Qt() const { return reinterpret_cast<const math::Qt&>(*this); }
 
     explicit operator i32x4() const { return _mm_cvtps_epi32(pack); }
+
+    /* */
+
+    f32* data() { return reinterpret_cast<f32*>(&pack); }
+    const f32* data() const { return (f32*)(&pack); }
+
+    f32& operator[](int i)             { ADT_ASSERT(i >= 0 && i < 4, "out of range, should be (>= 0 && < 4)"); return data()[i]; }
+    const f32& operator[](int i) const { ADT_ASSERT(i >= 0 && i < 4, "out of range, should be (>= 0 && < 4)"); return data()[i]; }
 };
 
 struct IV2x4;
@@ -200,6 +230,20 @@ i32x4Store(__m128i* const pDest, const i32x4 x)
     _mm_storeu_si128(pDest, x.pack);
 }
 
+/* zero extends */
+inline i32x4
+i32x4LoadU16(const u16* const ptr)
+{
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr)));
+}
+
+/* saturates to [0, 0xffff] */
+inline void
+i32x4StoreU16(u16* const pDest, const i32x4 x)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDest), _mm_packus_epi32(x.pack, x.pack));
+}
+
 inline i32x4
 operator+(const i32x4 l, const i32x4 r)
 {
@@ -314,6 +358,12 @@ operator>=(const i32x4 l, const i32x4 r)
     return _mm_cmpgt_epi32(l.pack, r.pack) | _mm_cmpeq_epi32(l.pack, r.pack);
 }
 
+inline i32x4
+operator==(const i32x4 l, const i32x4 r)
+{
+    return _mm_cmpeq_epi32(l.pack, r.pack);
+}
+
 inline i32x4
 operator<(const i32x4 l, const i32x4 r)
 {
@@ -499,6 +549,18 @@ max(const i32x4 l, const i32x4 r)
     return _mm_max_epi32(l.pack, r.pack);
 }
 
+inline f32x4
+min(const f32x4 l, const f32x4 r)
+{
+    return _mm_min_ps(l.pack, r.pack);
+}
+
+inline f32x4
+max(const f32x4 l, const f32x4 r)
+{
+    return _mm_max_ps(l.pack, r.pack);
+}
+
 inline f32x4
 floor(const f32x4 x)
 {
@@ -545,6 +607,42 @@ colorV3x4ToI32x4(simd::V3x4 color)
     return res;
 }
 
+/* Per channel a*(1 - t) + b*t of packed RGBA8 colors, t is 8.8 fixed point in [0, 256] per lane. */
+inline i32x4
+lerpRGBA8(const i32x4 a, const i32x4 b, const i32x4 t)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    /* spread each lane's weight over its 4 channels in 16 bit lanes */
+    const __m128i t2 = _mm_or_si128(t.pack, _mm_slli_epi32(t.pack, 16));
+    const __m128i tLo = _mm_unpacklo_epi32(t2, t2);
+    const __m128i tHi = _mm_unpackhi_epi32(t2, t2);
+    const __m128i oneMinusTLo = _mm_sub_epi16(_mm_set1_epi16(256), tLo);
+    const __m128i oneMinusTHi = _mm_sub_epi16(_mm_set1_epi16(256), tHi);
+
+    /* 255*256 + 128 still fits into u16 */
+    const __m128i half = _mm_set1_epi16(128);
+    __m128i lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(a.pack, zero), oneMinusTLo),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(b.pack, zero), tLo)
+    );
+    __m128i hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(a.pack, zero), oneMinusTHi),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(b.pack, zero), tHi)
+    );
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+
+    return _mm_packus_epi16(lo, hi);
+}
+
+/* Bilinear filter of 4 packed RGBA8 taps (alpha included), s and k are 8.8 fixed point horizontal and vertical weights. */
+inline i32x4
+bilinearRGBA8(const i32x4 c00, const i32x4 c10, const i32x4 c01, const i32x4 c11, const i32x4 s, const i32x4 k)
+{
+    return lerpRGBA8(lerpRGBA8(c00, c10, s), lerpRGBA8(c01, c11, s), k);
+}
+
 inline void
 i32Fillx4(Span<i32> src, const i32 x)
 {
@@ -583,6 +681,23 @@ i16Fillx8(Span<i16> src, const i16 x)
         src[i] = x;
 }
 
+/* Non-temporal fill, bypasses the cache. Needs _mm_sfence() before anything else reads the memory. */
+inline void
+i32StreamFillx4(Span<i32> src, const i32 x)
+{
+    const __m128i pack = _mm_set1_epi32(x);
+
+    isize i = 0;
+    for (; i < src.size() && (reinterpret_cast<usize>(&src[i]) & 15); ++i)
+        src[i] = x;
+
+    for (; i + 3 < src.size(); i += 4)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(&src[i]), pack);
+
+    for (; i < src.size(); ++i)
+        src[i] = x;
+}
+
 /* 128 bit end */
 
 #if defined ADT_AVX2
@@ -638,6 +753,14 @@ struct f32x8
     explicit operator __m256() const { return pack; }
 
     explicit operator i32x8() const { return _mm256_cvtps_epi32(pack); }
+
+    /* */
+
+    f32* data() { return reinterpret_cast<f32*>(this); }
+    const f32* data() const { return (f32*)(this); }
+
+    f32& operator[](int i)             { ADT_ASSERT(i >= 0 && i < 8, "out of range, should be (>= 0 && < 8) got: {}", i); return data()[i]; }
+    const f32& operator[](int i) const { ADT_ASSERT(i >= 0 && i < 8, "out of range, should be (>= 0 && < 8) got: {}", i); return data()[i]; }
 };
 
 struct IV2x8;
@@ -756,6 +879,20 @@ i32x8Store(__m256i* const pDest, const i32x8 x)
     _mm256_storeu_si256(pDest, x.pack);
 }
 
+inline i32x8
+i32x8LoadU16(const u16* const ptr)
+{
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+}
+
+inline void
+i32x8StoreU16(u16* const pDest, const i32x8 x)
+{
+    const __m128i lo = _mm256_castsi256_si128(x.pack);
+    const __m128i hi = _mm256_extracti128_si256(x.pack, 1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), _mm_packus_epi32(lo, hi));
+}
+
 inline i32x8
 operator+(const i32x8 l, const i32x8 r)
 {
@@ -870,6 +1007,12 @@ operator>=(const i32x8 l, const i32x8 r)
     return _mm256_cmpgt_epi32(l.pack, r.pack) | _mm256_cmpeq_epi32(l.pack, r.pack);
 }
 
+inline i32x8
+operator==(const i32x8 l, const i32x8 r)
+{
+    return _mm256_cmpeq_epi32(l.pack, r.pack);
+}
+
 inline i32x8
 operator<(const i32x8 l, const i32x8 r)
 {
@@ -1072,6 +1215,18 @@ max(const i32x8 l, const i32x8 r)
     return _mm256_max_epi32(l.pack, r.pack);
 }
 
+inline f32x8
+min(const f32x8 l, const f32x8 r)
+{
+    return _mm256_min_ps(l.pack, r.pack);
+}
+
+inline f32x8
+max(const f32x8 l, const f32x8 r)
+{
+    return _mm256_max_ps(l.pack, r.pack);
+}
+
 inline f32x8
 floor(const f32x8 x)
 {
@@ -1087,6 +1242,13 @@ floor(V2x8 a)
     return res;
 }
 
+inline V3x8
+lerp(V3x8 a, V3x8 b, f32x8 t)
+{
+    V3x8 res = (1.0f - t) * a + t * b;
+    return res;
+}
+
 inline simd::V3x8
 colorI32x8ToV3x8(simd::i32x8 color)
 {
@@ -1111,6 +1273,41 @@ colorV3x8ToI32x8(simd::V3x8 color)
     return res;
 }
 
+/* Per channel a*(1 - t) + b*t of packed RGBA8 colors, t is 8.8 fixed point in [0, 256] per lane. */
+inline i32x8
+lerpRGBA8(const i32x8 a, const i32x8 b, const i32x8 t)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    /* unpacks work within 128 bit halves, so the weights line up with the unpacked channels */
+    const __m256i t2 = _mm256_or_si256(t.pack, _mm256_slli_epi32(t.pack, 16));
+    const __m256i tLo = _mm256_unpacklo_epi32(t2, t2);
+    const __m256i tHi = _mm256_unpackhi_epi32(t2, t2);
+    const __m256i oneMinusTLo = _mm256_sub_epi16(_mm256_set1_epi16(256), tLo);
+    const __m256i oneMinusTHi = _mm256_sub_epi16(_mm256_set1_epi16(256), tHi);
+
+    const __m256i half = _mm256_set1_epi16(128);
+    __m256i lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(a.pack, zero), oneMinusTLo),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(b.pack, zero), tLo)
+    );
+    __m256i hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(a.pack, zero), oneMinusTHi),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b.pack, zero), tHi)
+    );
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, half), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, half), 8);
+
+    return _mm256_packus_epi16(lo, hi);
+}
+
+/* Bilinear filter of 8 packed RGBA8 taps (alpha included), s and k are 8.8 fixed point horizontal and vertical weights. */
+inline i32x8
+bilinearRGBA8(const i32x8 c00, const i32x8 c10, const i32x8 c01, const i32x8 c11, const i32x8 s, const i32x8 k)
+{
+    return lerpRGBA8(lerpRGBA8(c00, c10, s), lerpRGBA8(c01, c11, s), k);
+}
+
 inline void
 i32Fillx8(Span<i32> src, const i32 x)
 {
@@ -1137,12 +1334,588 @@ f32Fillx8(Span<f32> src, const f32 x)
         src[i] = x;
 }
 
+/* see i32StreamFillx4() */
+inline void
+i32StreamFillx8(Span<i32> src, const i32 x)
+{
+    const __m256i pack = _mm256_set1_epi32(x);
+
+    isize i = 0;
+    for (; i < src.size() && (reinterpret_cast<usize>(&src[i]) & 31); ++i)
+        src[i] = x;
+
+    for (; i + 7 < src.size(); i += 8)
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(&src[i]), pack);
+
+    for (; i < src.size(); ++i)
+        src[i] = x;
+}
+
 inline f32x4
 fma(const f32x4& a, f32 b, const f32x4& c)
 {
     return _mm_fmadd_ps(a.pack, f32x4(b).pack, c.pack);
 }
 
+inline f32x8
+fma(const f32x8& a, f32 b, const f32x8& c)
+{
+    return _mm256_fmadd_ps(a.pack, f32x8(b).pack, c.pack);
+}
+
+inline f32x8
+fma(const f32x8& a, const f32x8& b, const f32x8& c)
+{
+    return _mm256_fmadd_ps(a.pack, b.pack, c.pack);
+}
+
 #endif /* ADT_AVX2 */
 
+#if defined ADT_AVX512
+
+/* 512 bit, needs AVX512F and AVX512BW. Comparisons produce k-masks, they are widened back into lane masks. */
+
+struct f32x16;
+
+struct i32x16
+{
+    __m512i pack {};
+
+    /* */
+
+    i32x16() = default;
+
+    i32x16(const __m512i _pack) : pack(_pack) {}
+
+    i32x16(const i32 x) : pack(_mm512_set1_epi32(x)) {}
+
+    i32x16(
+        i32 x0, i32 x1, i32 x2, i32 x3, i32 x4, i32 x5, i32 x6, i32 x7,
+        i32 x8, i32 x9, i32 x10, i32 x11, i32 x12, i32 x13, i32 x14, i32 x15
+    ) : pack(_mm512_set_epi32(x15, x14, x13, x12, x11, x10, x9, x8, x7, x6, x5, x4, x3, x2, x1, x0)) {}
+
+    /* */
+
+    explicit operator __m512i() const { return pack; }
+
+    /* */
+
+    i32* data() { return reinterpret_cast<i32*>(this); }
+    const i32* data() const { return (i32*)(this); }
+
+    i32& operator[](int i)             { ADT_ASSERT(i >= 0 && i < 16, "out of range, should be (>= 0 && < 16) got: {}", i); return data()[i]; }
+    const i32& operator[](int i) const { ADT_ASSERT(i >= 0 && i < 16, "out of range, should be (>= 0 && < 16) got: {}", i); return data()[i]; }
+};
+
+struct f32x16
+{
+    __m512 pack {};
+
+    /* */
+
+    f32x16() = default;
+
+    f32x16(const __m512 _pack) : pack(_pack) {}
+
+    f32x16(const f32 x) : pack(_mm512_set1_ps(x)) {}
+
+    f32x16(i32x16 _pack) : pack {_mm512_cvtepi32_ps(_pack.pack)} {}
+
+    /* */
+
+    explicit operator __m512() const { return pack; }
+
+    explicit operator i32x16() const { return _mm512_cvtps_epi32(pack); }
+
+    /* */
+
+    f32* data() { return reinterpret_cast<f32*>(this); }
+    const f32* data() const { return (f32*)(this); }
+
+    f32& operator[](int i)             { ADT_ASSERT(i >= 0 && i < 16, "out of range, should be (>= 0 && < 16) got: {}", i); return data()[i]; }
+    const f32& operator[](int i) const { ADT_ASSERT(i >= 0 && i < 16, "out of range, should be (>= 0 && < 16) got: {}", i); return data()[i]; }
+};
+
+struct IV2x16;
+
+struct V2x16
+{
+    f32x16 x {}, y {};
+
+    /* */
+
+    V2x16() = default;
+    V2x16(IV2x16);
+
+    f32x16* data() { return reinterpret_cast<f32x16*>(this); }
+    const f32x16* data() const { return (f32x16*)(this); }
+
+    f32x16& operator[](int i)             { ADT_ASSERT(i >= 0 && i < 2, "out of range"); return data()[i]; }
+    const f32x16& operator[](int i) const { ADT_ASSERT(i >= 0 && i < 2, "out of range"); return data()[i]; }
+};
+
+struct IV2x16
+{
+    i32x16 x {}, y {};
+
+    /* */
+
+    IV2x16() = default;
+    IV2x16(f32x16 a, f32x16 b) : x(a), y(b) {}
+    IV2x16(V2x16 a) : x(a.x), y(a.y) {}
+
+    /* */
+
+    i32x16* data() { return reinterpret_cast<i32x16*>(this); }
+    const i32x16* data() const { return (i32x16*)(this); }
+
+    i32x16& operator[](int i)             { ADT_ASSERT(i >= 0 && i < 2, "out of range"); return data()[i]; }
+    const i32x16& operator[](int i) const { ADT_ASSERT(i >= 0 && i < 2, "out of range"); return data()[i]; }
+};
+
+inline
+V2x16::V2x16(IV2x16 a) : x(a.x), y(a.y) {}
+
+inline i32x16
+i32x16Reinterpret(const f32x16 x)
+{
+    return _mm512_castps_si512(x.pack);
+}
+
+inline f32x16
+f32x16Reinterpret(const i32x16 x)
+{
+    return _mm512_castsi512_ps(x.pack);
+}
+
+inline i32x16
+i32x16FromMask(const __mmask16 mask)
+{
+    return _mm512_maskz_set1_epi32(mask, -1);
+}
+
+inline i32x16
+i32x16Load(const i32* const ptr)
+{
+    return _mm512_loadu_si512(ptr);
+}
+
+inline i32x16
+i32x16Gather(i32* const p, const i32x16 offSets)
+{
+    return _mm512_i32gather_epi32(offSets.pack, p, 4);
+}
+
+inline f32x16
+f32x16Load(const f32* const ptr)
+{
+    return _mm512_loadu_ps(ptr);
+}
+
+inline void
+f32x16Store(f32* const pDest, const f32x16 x)
+{
+    _mm512_storeu_ps(pDest, x.pack);
+}
+
+inline void
+i32x16Store(i32* const pDest, const i32x16 x)
+{
+    _mm512_storeu_si512(pDest, x.pack);
+}
+
+inline i32x16
+i32x16LoadU16(const u16* const ptr)
+{
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+}
+
+inline void
+i32x16StoreU16(u16* const pDest, const i32x16 x)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDest), _mm512_cvtusepi32_epi16(x.pack));
+}
+
+inline i32x16
+operator+(const i32x16 l, const i32x16 r)
+{
+    return _mm512_add_epi32(l.pack, r.pack);
+}
+
+inline f32x16
+operator+(const f32x16 l, const f32x16 r)
+{
+    return _mm512_add_ps(l.pack, r.pack);
+}
+
+inline f32x16
+operator-(const f32x16 l, const f32x16 r)
+{
+    return _mm512_sub_ps(l.pack, r.pack);
+}
+
+inline f32x16&
+operator+=(f32x16& l, const f32x16 r)
+{
+    return l = l + r;
+}
+
+inline f32x16&
+operator-=(f32x16& l, const f32x16 r)
+{
+    return l = l - r;
+}
+
+inline i32x16
+operator-(const i32x16 l, const i32x16 r)
+{
+    return _mm512_sub_epi32(l.pack, r.pack);
+}
+
+inline i32x16&
+operator+=(i32x16& l, const i32x16 r)
+{
+    return l = l + r;
+}
+
+inline i32x16&
+operator-=(i32x16& l, const i32x16 r)
+{
+    return l = l - r;
+}
+
+inline i32x16
+operator*(const i32x16 l, const i32x16 r)
+{
+    return _mm512_mullo_epi32(l.pack, r.pack);
+}
+
+inline i32x16&
+operator*=(i32x16& l, const i32x16 r)
+{
+    return l = l * r;
+}
+
+inline f32x16
+operator*(const f32x16 l, const f32x16 r)
+{
+    return _mm512_mul_ps(l.pack, r.pack);
+}
+
+inline f32x16
+operator*(const f32x16 l, const f32 r)
+{
+    return l * f32x16(r);
+}
+
+inline f32x16
+operator/(const f32x16 l, const f32x16 r)
+{
+    return _mm512_div_ps(l.pack, r.pack);
+}
+
+inline i32x16
+operator|(const i32x16 l, const i32x16 r)
+{
+    return _mm512_or_si512(l.pack, r.pack);
+}
+
+inline i32x16
+operator&(const i32x16 l, const i32x16 r)
+{
+    return _mm512_and_si512(l.pack, r.pack);
+}
+
+/* _mm512_and_ps is AVX512DQ */
+inline f32x16
+operator&(const f32x16 l, const f32x16 r)
+{
+    return f32x16Reinterpret(i32x16Reinterpret(l) & i32x16Reinterpret(r));
+}
+
+inline f32x16
+operator-(const f32x16 r)
+{
+    return r * f32x16(-1.0f);
+}
+
+inline f32x16
+operator<(const f32x16 l, const f32x16 r)
+{
+    return f32x16Reinterpret(i32x16FromMask(_mm512_cmp_ps_mask(l.pack, r.pack, _CMP_LT_OQ)));
+}
+
+inline i32x16
+operator>=(const i32x16 l, const i32x16 r)
+{
+    return i32x16FromMask(_mm512_cmpge_epi32_mask(l.pack, r.pack));
+}
+
+inline i32x16
+operator==(const i32x16 l, const i32x16 r)
+{
+    return i32x16FromMask(_mm512_cmpeq_epi32_mask(l.pack, r.pack));
+}
+
+inline i32x16
+operator<(const i32x16 l, const i32x16 r)
+{
+    return i32x16FromMask(_mm512_cmplt_epi32_mask(l.pack, r.pack));
+}
+
+inline i32x16
+operator<<(i32x16 a, i32 b)
+{
+    i32x16 res;
+    res.pack = _mm512_slli_epi32(a.pack, b);
+    return res;
+}
+
+inline i32x16
+operator>>(i32x16 a, i32 b)
+{
+    i32x16 res;
+    res.pack = _mm512_srli_epi32(a.pack, b);
+    return res;
+}
+
+inline V2x16
+operator+(const V2x16 l, const V2x16 r)
+{
+    V2x16 res;
+    res.x = l.x + r.x;
+    res.y = l.y + r.y;
+    return res;
+}
+
+inline V2x16
+operator-(const V2x16 l, const V2x16 r)
+{
+    V2x16 res;
+    res.x = l.x - r.x;
+    res.y = l.y - r.y;
+    return res;
+}
+
+inline V2x16
+operator-(const V2x16 l, const math::V2 r)
+{
+    V2x16 res;
+    res.x = l.x - r.x;
+    res.y = l.y - r.y;
+    return res;
+}
+
+inline V2x16
+operator+(const V2x16 l, const math::V2 r)
+{
+    V2x16 res;
+    res.x = l.x + r.x;
+    res.y = l.y + r.y;
+    return res;
+}
+
+inline V2x16
+operator*(const f32x16 l, math::V2 r)
+{
+    V2x16 res;
+    res.x = l * r.x;
+    res.y = l * r.y;
+    return res;
+}
+
+inline V2x16
+operator*(const V2x16 l, math::V2 r)
+{
+    V2x16 res;
+    res.x = l.x * r.x;
+    res.y = l.y * r.y;
+    return res;
+}
+
+inline V2x16
+operator/(const V2x16 l, math::V2 r)
+{
+    V2x16 res;
+    res.x = l.x / r.x;
+    res.y = l.y / r.y;
+    return res;
+}
+
+inline V2x16
+operator/(const V2x16 l, const f32x16 r)
+{
+    V2x16 res;
+    res.x = l.x / r;
+    res.y = l.y / r;
+    return res;
+}
+
+inline V2x16&
+operator/=(V2x16& l, const f32x16 r)
+{
+    return l = l / r;
+}
+
+inline IV2x16
+operator+(IV2x16 l, math::IV2 r)
+{
+    IV2x16 res;
+    res.x = l.x + r.x;
+    res.y = l.y + r.y;
+    return res;
+}
+
+inline i32x16
+andNot(const i32x16 mask, i32x16 x)
+{
+    return _mm512_andnot_si512(mask.pack, x.pack);
+}
+
+inline f32x16
+andNot(const f32x16 mask, f32x16 x)
+{
+    return f32x16Reinterpret(andNot(i32x16Reinterpret(mask), i32x16Reinterpret(x)));
+}
+
+/* one bit per byte like the narrower ones, so 64 bits */
+inline u64
+moveMask8(const i32x16 x)
+{
+    return _mm512_movepi8_mask(x.pack);
+}
+
+inline i32x16
+min(const i32x16 l, const i32x16 r)
+{
+    return _mm512_min_epi32(l.pack, r.pack);
+}
+
+inline i32x16
+max(const i32x16 l, const i32x16 r)
+{
+    return _mm512_max_epi32(l.pack, r.pack);
+}
+
+inline f32x16
+min(const f32x16 l, const f32x16 r)
+{
+    return _mm512_min_ps(l.pack, r.pack);
+}
+
+inline f32x16
+max(const f32x16 l, const f32x16 r)
+{
+    return _mm512_max_ps(l.pack, r.pack);
+}
+
+inline f32x16
+floor(const f32x16 x)
+{
+    return _mm512_roundscale_ps(x.pack, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+inline V2x16
+floor(V2x16 a)
+{
+    V2x16 res;
+    res.x = floor(a.x);
+    res.y = floor(a.y);
+    return res;
+}
+
+/* Per channel a*(1 - t) + b*t of packed RGBA8 colors, t is 8.8 fixed point in [0, 256] per lane. */
+inline i32x16
+lerpRGBA8(const i32x16 a, const i32x16 b, const i32x16 t)
+{
+    const __m512i zero = _mm512_setzero_si512();
+
+    /* unpacks work within 128 bit quarters, so the weights line up with the unpacked channels */
+    const __m512i t2 = _mm512_or_si512(t.pack, _mm512_slli_epi32(t.pack, 16));
+    const __m512i tLo = _mm512_unpacklo_epi32(t2, t2);
+    const __m512i tHi = _mm512_unpackhi_epi32(t2, t2);
+    const __m512i oneMinusTLo = _mm512_sub_epi16(_mm512_set1_epi16(256), tLo);
+    const __m512i oneMinusTHi = _mm512_sub_epi16(_mm512_set1_epi16(256), tHi);
+
+    const __m512i half = _mm512_set1_epi16(128);
+    __m512i lo = _mm512_add_epi16(
+        _mm512_mullo_epi16(_mm512_unpacklo_epi8(a.pack, zero), oneMinusTLo),
+        _mm512_mullo_epi16(_mm512_unpacklo_epi8(b.pack, zero), tLo)
+    );
+    __m512i hi = _mm512_add_epi16(
+        _mm512_mullo_epi16(_mm512_unpackhi_epi8(a.pack, zero), oneMinusTHi),
+        _mm512_mullo_epi16(_mm512_unpackhi_epi8(b.pack, zero), tHi)
+    );
+    lo = _mm512_srli_epi16(_mm512_add_epi16(lo, half), 8);
+    hi = _mm512_srli_epi16(_mm512_add_epi16(hi, half), 8);
+
+    return _mm512_packus_epi16(lo, hi);
+}
+
+/* Bilinear filter of 16 packed RGBA8 taps (alpha included), s and k are 8.8 fixed point horizontal and vertical weights. */
+inline i32x16
+bilinearRGBA8(const i32x16 c00, const i32x16 c10, const i32x16 c01, const i32x16 c11, const i32x16 s, const i32x16 k)
+{
+    return lerpRGBA8(lerpRGBA8(c00, c10, s), lerpRGBA8(c01, c11, s), k);
+}
+
+inline void
+i32Fillx16(Span<i32> src, const i32 x)
+{
+    const i32x16 pack = x;
+
+    isize i = 0;
+    for (; i + 15 < src.size(); i += 16)
+        i32x16Store(&src[i], pack);
+
+    for (; i < src.size(); ++i)
+        src[i] = x;
+}
+
+inline void
+f32Fillx16(Span<f32> src, const f32 x)
+{
+    const f32x16 pack = x;
+
+    isize i = 0;
+    for (; i + 15 < src.size(); i += 16)
+        f32x16Store(&src[i], pack);
+
+    for (; i < src.size(); ++i)
+        src[i] = x;
+}
+
+/* see i32StreamFillx4() */
+inline void
+i32StreamFillx16(Span<i32> src, const i32 x)
+{
+    const __m512i pack = _mm512_set1_epi32(x);
+
+    isize i = 0;
+    for (; i < src.size() && (reinterpret_cast<usize>(&src[i]) & 63); ++i)
+        src[i] = x;
+
+    for (; i + 15 < src.size(); i += 16)
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(&src[i]), pack);
+
+    for (; i < src.size(); ++i)
+        src[i] = x;
+}
+
+inline f32x16
+fma(const f32x16& a, f32 b, const f32x16& c)
+{
+    return _mm512_fmadd_ps(a.pack, f32x16(b).pack, c.pack);
+}
+
+inline f32x16
+fma(const f32x16& a, const f32x16& b, const f32x16& c)
+{
+    return _mm512_fmadd_ps(a.pack, b.pack, c.pack);
+}
+
+#endif /* ADT_AVX512 */
+
+} /* inline namespace */
+
 } /* namespace adt::simd */
@@ -94,6 +94,14 @@ constexpr InitFlag INIT {};
     #define ADT_ALWAYS_INLINE inline
 #endif
 
+/* Inlines every call inside of the function, so it never calls out-of-line copies of header functions.
+ * Not with asserts on: flattening the print machinery behind them takes the compiler forever. */
+#if (defined __clang__ || defined __GNUC__) && defined NDEBUG
+    #define ADT_FLATTEN __attribute__((flatten))
+#else
+    #define ADT_FLATTEN
+#endif
+
 #if defined _WIN32
     #define ADT_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
 #else
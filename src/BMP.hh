@@ -221,6 +221,48 @@ writeToFile(const Image img, const char* ntsFile)
     // LOG_NOTIFY("written: w/h: [{}, {}]\n", img.m_width, img.m_height);
 }
 
+/* 32 bits per pixel, bottom up rows. Memory order of the sw framebuffer is BGRA with the bottom row first, which is exactly that. */
+inline void
+writeToFile(const adt::Span2D<ImagePixelRGBA> sp, const char* ntsFile)
+{
+    FILE* fp = fopen(ntsFile, "wb");
+    if (!fp)
+    {
+        LOG_BAD("fopen(\"{}\", \"wb\") failed\n", ntsFile);
+        return;
+    }
+    defer( fclose(fp) );
+
+    const adt::u32 imageSize = adt::u32(sp.width() * sp.height() * 4);
+
+    Header head {
+        .BM = adt::u32('B' | 'M' << 8),
+        .size = adt::u32(sizeof(Header) + sizeof(BitmapInfoHeader) + imageSize),
+        .offset = sizeof(Header) + sizeof(BitmapInfoHeader),
+    };
+
+    BitmapInfoHeader info {
+        .size = sizeof(BitmapInfoHeader),
+        .width = adt::i32(sp.width()),
+        .height = adt::i32(sp.height()),
+        .nPlanes = 1,
+        .nBitsPerPixel = 32,
+        .eCompressionMethod = COMPRESSION_METHOD_ID::RGB,
+        .imageSize = imageSize,
+        .hRes = 0,
+        .vRes = 0,
+        .nColors = 0,
+        .nColorsUsed = 0,
+    };
+
+    fwrite(&head, sizeof(head), 1, fp);
+    fwrite(&info, sizeof(info), 1, fp);
+
+    /* rows are stride apart */
+    for (adt::isize y = 0; y < sp.height(); ++y)
+        fwrite(&sp(0, y), sp.width() * 4, 1, fp);
+}
+
 };
 
 #ifdef DBG_BMP
@@ -5,10 +5,9 @@
 #ifdef OPT_SW
     #include "adt/Span2D.hh"
     #include "adt/Vec.hh"
-    #include "adt/simd.hh"
-
     #include "Image.hh"
     #include "colors.hh"
+    #include "cpu/cpu.hh"
 #endif
 
 namespace adt
@@ -77,15 +76,28 @@ struct IWindow
     virtual void unbindContext() = 0;
 
 #ifdef OPT_SW
+    /* m_vHiZBuffer holds the max depth of each HI_Z_BLOCK_SIZE x HI_Z_BLOCK_SIZE block of m_vDepthBuffer */
+    static constexpr int HI_Z_BLOCK_SIZE = 8;
+
     void (*m_pfnUpdateCB)(void*) {};
     void* m_pDrawArg {};
     adt::Vec<adt::f32> m_vDepthBuffer {};
+    adt::Vec<adt::f32> m_vHiZBuffer {};
+    adt::Vec<adt::i32> m_vVisibilityBuffer {}; /* triangle index per pixel, same layout as m_vDepthBuffer */
 
     /* */
 
     virtual adt::Span2D<ImagePixelRGBA> surfaceBuffer() = 0;
     virtual void scheduleFrame() = 0;
 
+    /* Shows only the top left width x height of surfaceBuffer(), stretched over the window.
+     * False if the window can't scale, the renderer then has to fill all of surfaceBuffer() itself. */
+    virtual bool presentRect(int, int) { return false; }
+
+    /* Rect of surfaceBuffer() (bottom row first) that changed since the previous frame.
+     * The renderer reports every change each frame, windows that don't track damage repaint everything. */
+    virtual void damageRect(int, int, int, int) {}
+
     /* */
 
     adt::Span2D<adt::f32>
@@ -96,43 +108,74 @@ struct IWindow
         };
     }
 
+    /* m_vDepthBuffer storage viewed as the integer depth formats, same stride */
+    adt::Span2D<adt::u16>
+    depthBuffer16()
+    {
+        return {
+            reinterpret_cast<adt::u16*>(m_vDepthBuffer.data()), m_width, m_height, m_stride
+        };
+    }
+
+    adt::Span2D<adt::u32>
+    depthStencilBuffer()
+    {
+        return {
+            reinterpret_cast<adt::u32*>(m_vDepthBuffer.data()), m_width, m_height, m_stride
+        };
+    }
+
+    adt::Span2D<adt::f32>
+    hiZBuffer()
+    {
+        /* spans the stride padding too, so row groups wider than a block have an entry for every lane */
+        const int width = (m_stride + HI_Z_BLOCK_SIZE - 1) / HI_Z_BLOCK_SIZE;
+        const int height = (m_height + HI_Z_BLOCK_SIZE - 1) / HI_Z_BLOCK_SIZE;
+
+        return {
+            m_vHiZBuffer.data(), width, height, width
+        };
+    }
+
+    adt::Span2D<adt::i32>
+    visibilityBuffer()
+    {
+        return {
+            m_vVisibilityBuffer.data(), m_width, m_height, m_stride
+        };
+    }
+
     void
-    clearSurfaceBuffer(adt::math::V4 color)
+    allocDepthBuffers()
     {
-#ifdef ADT_AVX2
-        adt::simd::i32Fillx8(
-            adt::Span<adt::i32>{
-                (adt::i32*)surfaceBuffer().data(),
-                surfaceBuffer().getStride() * surfaceBuffer().getHeight()
-            },
-            colors::V4ToRGBA(color)
-        );
-#else
+        m_vDepthBuffer.setSize(m_pAlloc, m_stride * m_height);
+        m_vHiZBuffer.setSize(m_pAlloc, hiZBuffer().width() * hiZBuffer().height());
+        m_vVisibilityBuffer.setSize(m_pAlloc, m_stride * m_height);
+    }
 
-        adt::simd::i32Fillx4(
+    void
+    clearSurfaceBuffer(adt::math::V4 color)
+    {
+        cpu::kernels().pfnFillI32(
             adt::Span<adt::i32>{
                 (adt::i32*)surfaceBuffer().data(),
-                surfaceBuffer().getStride() * surfaceBuffer().getHeight()
+                surfaceBuffer().stride() * surfaceBuffer().height()
             },
             colors::V4ToRGBA(color)
         );
-#endif /* ADT_AVX2 */
     }
 
     void
     clearDepthBuffer()
     {
-#ifdef ADT_AVX2
-        adt::simd::f32Fillx8(
+        cpu::kernels().pfnFillF32(
             {m_vDepthBuffer.data(), m_vDepthBuffer.size()},
             std::numeric_limits<adt::f32>::max()
         );
-#else
-        adt::simd::f32Fillx4(
-            {m_vDepthBuffer.data(), m_vDepthBuffer.size()},
+        cpu::kernels().pfnFillF32(
+            {m_vHiZBuffer.data(), m_vHiZBuffer.size()},
             std::numeric_limits<adt::f32>::max()
         );
-#endif /* ADT_AVX2 */
     }
 
     void
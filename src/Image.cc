@@ -1,8 +1,10 @@
 #include "Image.hh"
 
+#include "cpu/cpu.hh"
+
+#include "adt/StdAllocator.hh"
 #include "adt/defer.hh"
 #include "adt/utils.hh"
-#include "adt/simd.hh"
 
 using namespace adt;
 
@@ -66,50 +68,10 @@ Image::cloneToRGBA(adt::IAllocator* pAlloc)
 void
 Image::swapRedBlue()
 {
-    using namespace adt::simd;
-
     switch (m_eType)
     {
         case Image::TYPE::RGBA:
-        {
-            const isize size = m_width * m_height;
-            isize i = 0;
-
-#ifdef ADT_AVX2
-            const isize divLen = size / 8;
-            auto* pData = reinterpret_cast<__m256i*>(m_uData.pRGBA);
-            for (; i < divLen; ++i, ++pData)
-            {
-                i32x8 x = i32x8Load(pData);
-
-                i32x8 red =   (x & 0x000000ff) << 8 * 2;
-                i32x8 green = (x & 0x0000ff00);
-                i32x8 blue =  (x & 0x00ff0000) >> 8 * 2;
-                i32x8 alpha = (x & 0xff000000);
-
-                i32x8Store(pData, red | green | blue | alpha);
-            }
-            i = divLen * 8;
-#else
-            const isize divLen = size / 4;
-            auto* pData = reinterpret_cast<__m128i*>(m_uData.pRGBA);
-            for (; i < divLen; ++i, ++pData)
-            {
-                i32x4 x = i32x4Load(pData);
-
-                i32x4 red =   (x & 0x000000ff) << 8 * 2;
-                i32x4 green = (x & 0x0000ff00);
-                i32x4 blue =  (x & 0x00ff0000) >> 8 * 2;
-                i32x4 alpha = (x & 0xff000000);
-
-                i32x4Store(pData, red | green | blue | alpha);
-            }
-            i = divLen * 4;
-#endif
-
-            for (; i < size; ++i)
-                utils::swap(&m_uData.pRGBA[i].r, &m_uData.pRGBA[i].b);
-        }
+        cpu::kernels().pfnSwapRedBlueRGBA({m_uData.pRGBA, m_width * m_height});
         break;
 
         case Image::TYPE::RGB:
@@ -182,3 +144,119 @@ Image::flipVertically(adt::IAllocator* pAlloc)
         break;
     }
 }
+
+void
+Image::genMipsRGBA(adt::IAllocator* pAlloc)
+{
+    ADT_ASSERT(m_eType == TYPE::RGBA, " ");
+    ADT_ASSERT(m_nMips == 0, "already generated");
+
+    isize totalSize = 0;
+    int nLevels = 0;
+    {
+        int width = m_width;
+        int height = m_height;
+        for (;;)
+        {
+            totalSize += width * height;
+            ++nLevels;
+            if (width == 1 && height == 1) break;
+
+            width = utils::max(width / 2, 1);
+            height = utils::max(height / 2, 1);
+        }
+    }
+
+    m_uData.pRGBA = pAlloc->reallocV<ImagePixelRGBA>(m_uData.pRGBA, m_width * m_height, totalSize);
+    m_nMips = static_cast<u8>(nLevels - 1);
+
+    /* 2x2 box filter. On an odd source axis the last destination texel also takes the leftover row or column,
+     * a 3 wide box there, so nothing gets dropped or shifted. */
+    for (int level = 1; level < nLevels; ++level)
+    {
+        const auto spSrc = mipRGBA(level - 1);
+        const auto spDst = mipRGBA(level);
+        auto* pDst = const_cast<ImagePixelRGBA*>(spDst.data());
+
+        /* source texels of destination texel i along an axis */
+        auto clTaps = [](const int i, const int srcSize, const int dstSize) -> int {
+            if (srcSize == 1) return 1;
+            return (i == dstSize - 1 && srcSize % 2 == 1) ? 3 : 2;
+        };
+
+        for (int y = 0; y < spDst.height(); ++y)
+        {
+            const int nTapsY = clTaps(y, static_cast<int>(spSrc.height()), static_cast<int>(spDst.height()));
+
+            for (int x = 0; x < spDst.width(); ++x)
+            {
+                const int nTapsX = clTaps(x, static_cast<int>(spSrc.width()), static_cast<int>(spDst.width()));
+
+                int r = 0, g = 0, b = 0, a = 0;
+                for (int tapY = 0; tapY < nTapsY; ++tapY)
+                {
+                    for (int tapX = 0; tapX < nTapsX; ++tapX)
+                    {
+                        const ImagePixelRGBA src = spSrc(x*2 + tapX, y*2 + tapY);
+                        r += src.r;
+                        g += src.g;
+                        b += src.b;
+                        a += src.a;
+                    }
+                }
+
+                const int n = nTapsX * nTapsY;
+                ImagePixelRGBA p;
+                p.r = static_cast<u8>((r + n/2) / n);
+                p.g = static_cast<u8>((g + n/2) / n);
+                p.b = static_cast<u8>((b + n/2) / n);
+                p.a = static_cast<u8>((a + n/2) / n);
+
+                pDst[y*spDst.width() + x] = p;
+            }
+        }
+    }
+}
+
+void
+Image::tileRGBA(adt::IAllocator* pAlloc)
+{
+    ADT_ASSERT(m_eType == TYPE::RGBA, " ");
+    ADT_ASSERT(m_eLayout == LAYOUT::LINEAR, "already tiled");
+
+    const Image linear = *this;
+    const isize linearSize = (linear.mipRGBA(m_nMips).data() - linear.m_uData.pRGBA) +
+        linear.mipRGBA(m_nMips).width() * linear.mipRGBA(m_nMips).height();
+
+    m_eLayout = LAYOUT::TILED_4X4;
+    const auto spLastTiled = mipRGBA(m_nMips);
+    const isize tiledSize = (spLastTiled.data() - m_uData.pRGBA) + spLastTiled.stride() * ((spLastTiled.height() + 3) & ~3);
+
+    auto* pTemp = StdAllocator::inst()->mallocV<ImagePixelRGBA>(linearSize);
+    defer( StdAllocator::inst()->free(pTemp) );
+    utils::memCopy(pTemp, linear.m_uData.pRGBA, linearSize);
+
+    m_uData.pRGBA = pAlloc->reallocV<ImagePixelRGBA>(m_uData.pRGBA, linearSize, tiledSize);
+
+    Image temp = linear;
+    temp.m_uData.pRGBA = pTemp;
+
+    for (int level = 0; level <= m_nMips; ++level)
+    {
+        const auto spSrc = temp.mipRGBA(level);
+        const auto spDst = mipRGBA(level);
+        auto* pDst = const_cast<ImagePixelRGBA*>(spDst.data());
+        const int paddedHeight = (spDst.height() + 3) & ~3;
+
+        /* padding repeats the edge texels */
+        for (int y = 0; y < paddedHeight; ++y)
+        {
+            const int srcY = utils::min(y, static_cast<int>(spSrc.height()) - 1);
+            for (int x = 0; x < spDst.stride(); ++x)
+            {
+                const int srcX = utils::min(x, static_cast<int>(spSrc.width()) - 1);
+                pDst[tiledOffset(x, y, spDst.stride())] = spSrc(srcX, srcY);
+            }
+        }
+    }
+}
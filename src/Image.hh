@@ -3,6 +3,7 @@
 #include "adt/IAllocator.hh"
 #include "adt/Span2D.hh"
 #include "adt/types.hh"
+#include "adt/utils.hh"
 
 union ImagePixelRGBA
 {
@@ -21,6 +22,10 @@ struct Image
 {
     enum class TYPE : adt::u8 { RGBA, RGB, MONO };
 
+    /* TILED_4X4: every level is padded up to multiples of 4 and stored as row major 4x4 blocks of row major texels,
+     * so a bilinear footprint usually touches a single cache line. */
+    enum class LAYOUT : adt::u8 { LINEAR, TILED_4X4 };
+
     /* */
 
     union
@@ -32,17 +37,51 @@ struct Image
     adt::i16 m_width {};
     adt::i16 m_height {};
     TYPE m_eType {};
+    adt::u8 m_nMips {}; /* levels stored right after the base level, each is half the size of the previous one */
+    LAYOUT m_eLayout {};
 
     /* */
 
     [[nodiscard]] Image cloneToRGBA(adt::IAllocator* pAlloc);
     void swapRedBlue();
     void flipVertically(adt::IAllocator* pAlloc);
+    void genMipsRGBA(adt::IAllocator* pAlloc); /* must be the last allocation to grow in place */
+    void tileRGBA(adt::IAllocator* pAlloc); /* converts every level to TILED_4X4, same allocation rules as genMipsRGBA() */
+
+    /* Level 0 is the base level.
+     * For TILED_4X4 the stride is the padded width and texels must be addressed with tiledOffset(). */
+    adt::Span2D<const ImagePixelRGBA>
+    mipRGBA(int level) const
+    {
+        ADT_ASSERT(m_eType == TYPE::RGBA, " ");
+        ADT_ASSERT(level >= 0 && level <= m_nMips, "level: {}, nMips: {}", level, m_nMips);
+
+        const int pad = m_eLayout == LAYOUT::TILED_4X4 ? 3 : 0;
+        const ImagePixelRGBA* pData = m_uData.pRGBA;
+        int width = m_width;
+        int height = m_height;
+
+        for (int i = 0; i < level; ++i)
+        {
+            pData += ((width + pad) & ~pad) * ((height + pad) & ~pad);
+            width = adt::utils::max(width / 2, 1);
+            height = adt::utils::max(height / 2, 1);
+        }
+
+        return {pData, width, height, (width + pad) & ~pad};
+    }
+
+    static int
+    tiledOffset(int x, int y, int paddedWidth)
+    {
+        return (y & ~3)*paddedWidth + ((x & ~3) << 2) + ((y & 3) << 2) + (x & 3);
+    }
 
     adt::Span2D<ImagePixelRGBA>
     spanRGBA()
     {
         ADT_ASSERT(m_eType == TYPE::RGBA, " ");
+        ADT_ASSERT(m_eLayout == LAYOUT::LINEAR, " ");
         return {m_uData.pRGBA, m_width, m_height, m_width};
     }
 
@@ -50,6 +89,7 @@ struct Image
     spanRGBA() const
     {
         ADT_ASSERT(m_eType == TYPE::RGBA, " ");
+        ADT_ASSERT(m_eLayout == LAYOUT::LINEAR, " ");
         return {m_uData.pRGBA, m_width, m_height, m_width};
     }
 
@@ -18,6 +18,8 @@
 #endif
 
 #if defined OPT_SW
+    #include "platform/headless/Window.hh"
+    #include "render/rt/rt.hh"
     #include "render/sw/sw.hh"
 #endif
 
@@ -59,6 +61,11 @@ allocWindow(IAllocator* pAlloc, const char* ntsName)
         case WINDOW_TYPE::WINDOWS:
         return pAlloc->alloc<platform::win32::Window>(pAlloc, ntsName);
 #endif
+
+#if defined OPT_SW
+        case WINDOW_TYPE::HEADLESS:
+        return pAlloc->alloc<platform::headless::Window>(pAlloc, ntsName);
+#endif
     }
 
     throw RuntimeException("failed to create the window");
@@ -78,6 +85,9 @@ allocRenderer(IAllocator* pAlloc)
 #if defined OPT_SW
         case RENDERER_TYPE::SW:
         return pAlloc->alloc<render::sw::Renderer>();
+
+        case RENDERER_TYPE::RAY_TRACE:
+        return pAlloc->alloc<render::rt::Renderer>();
 #endif
 
 #if defined OPT_GL
@@ -8,8 +8,8 @@
 namespace app
 {
 
-enum class WINDOW_TYPE : adt::u8 { WAYLAND_SHM, WAYLAND_GL, WINDOWS };
-enum class RENDERER_TYPE : adt::u8 { SW, OPEN_GL };
+enum class WINDOW_TYPE : adt::u8 { WAYLAND_SHM, WAYLAND_GL, WINDOWS, HEADLESS };
+enum class RENDERER_TYPE : adt::u8 { SW, OPEN_GL, RAY_TRACE };
 
 /* depend on global `g_eWindowType` and `g_eRendererType` */
 IWindow* allocWindow(adt::IAllocator* pAlloc, const char* ntsName);
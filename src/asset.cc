@@ -35,14 +35,24 @@ loadBMP([[maybe_unused]] const StringView svPath, const StringView sFile)
     if (!reader.read(sFile))
         return {};
 
-    Object nObj(sFile.size() * 1.33);
+    /* rgb to rgba is 4/3, the mip chain adds another 1/3 and tiling pads the small levels */
+    Object nObj(sFile.size() * 1.9);
 
     Image img = reader.getImage();
 
     img = img.cloneToRGBA(&nObj.m_arena);
-    if (app::g_eWindowType != app::WINDOW_TYPE::WAYLAND_SHM)
+    /* shm and headless buffers are BGRA already */
+    if (app::g_eWindowType != app::WINDOW_TYPE::WAYLAND_SHM && app::g_eWindowType != app::WINDOW_TYPE::HEADLESS)
         img.swapRedBlue();
 
+    /* gl uploads level 0 only */
+    if (app::g_eRendererType != app::RENDERER_TYPE::OPEN_GL)
+        img.genMipsRGBA(&nObj.m_arena);
+
+    /* only the SW sampler knows how to address tiled textures */
+    if (app::g_eRendererType == app::RENDERER_TYPE::SW)
+        img.tileRGBA(&nObj.m_arena);
+
     nObj.m_uData.img = img;
     nObj.m_eType = Object::TYPE::IMAGE;
 
@@ -3,6 +3,10 @@
 #include "keys.hh"
 #include "app.hh"
 
+#ifdef OPT_SW
+    #include "render/sw/sw.hh"
+#endif
+
 #include "adt/logs.hh"
 #include "adt/defer.hh"
 
@@ -27,6 +31,21 @@ static void toggleVSync() { app::windowInst().toggleVSync(); }
 static void togglePause() { utils::toggle(&g_bPauseSimulation); LOG_WARN("PAUSE: {}\n", g_bPauseSimulation); }
 static void toggleDrawUI() { utils::toggle(&g_bDrawUI); LOG_WARN("draw UI: {}\n", g_bDrawUI); }
 
+#ifdef OPT_SW
+static void
+cycleDepthFormat()
+{
+    using namespace render::sw;
+    g_eDepthFormat = static_cast<DEPTH_FORMAT>((static_cast<int>(g_eDepthFormat) + 1) % (static_cast<int>(DEPTH_FORMAT::UNORM24_STENCIL8) + 1));
+    LOG_WARN("depth format: {}\n", depthFormatName(g_eDepthFormat));
+}
+
+static void toggleTrilinearFiltering() { utils::toggle(&render::sw::g_bTrilinearFiltering); LOG_WARN("trilinear filtering: {}\n", render::sw::g_bTrilinearFiltering); }
+static void toggleVisibilityBuffer() { utils::toggle(&render::sw::g_bVisibilityBuffer); LOG_WARN("visibility buffer: {}\n", render::sw::g_bVisibilityBuffer); }
+static void togglePostProcess() { utils::toggle(&render::sw::g_bPostProcess); LOG_WARN("post-process: {}\n", render::sw::g_bPostProcess); }
+static void toggleShadows() { utils::toggle(&render::sw::g_bShadows); LOG_WARN("shadows: {}\n", render::sw::g_bShadows); }
+#endif
+
 Camera g_camera {.m_pos {0, 0, -3}, .m_lastMove {}, .m_sens = 0.05f, .m_speed = 4.0f, .m_fov = 60.0f};
 Mouse g_mouse;
 bool g_abPrevPressed[MAX_KEY_VALUE];
@@ -38,6 +57,13 @@ MOD_STATE g_ePressedMods;
 Array<Keybind, MAX_KEYBINDS> g_aKeybinds {
     {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_H,        toggleDrawUI         },
     {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_P,        togglePause          },
+#ifdef OPT_SW
+    {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_T,        toggleTrilinearFiltering},
+    {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_B,        toggleVisibilityBuffer},
+    {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_Z,        cycleDepthFormat     },
+    {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_X,        togglePostProcess    },
+    {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_C,        toggleShadows        },
+#endif
     {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_F,        toggleFullscreen     },
     {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_R,        toggleRelativePointer},
     {REPEAT::ONCE,       EXEC_ON::PRESS,   MOD_STATE::ANY,   KEY_V,        toggleVSync          },
@@ -117,24 +143,7 @@ procMouse()
     if (g_camera.m_pitch > 89.9f) g_camera.m_pitch = 89.9f;
     if (g_camera.m_pitch < -89.9f) g_camera.m_pitch = -89.9f;
 
-    const M4 yawTrm = M4RotFrom(0, toRad(-g_camera.m_yaw), 0);
-    const M4 pitchTrm = M4RotFrom(toRad(g_camera.m_pitch), 0, 0);
-    const M4 axisTrm = yawTrm * pitchTrm;
-
-    const V3 right = V3Norm((axisTrm * V4From(CAMERA_RIGHT, 0.0f)).xyz);
-    const V3 up = V3Norm((axisTrm * V4From(CAMERA_UP, 0.0f)).xyz);
-    const V3 lookAt = V3Norm((axisTrm * V4From(CAMERA_FRONT, 0.0f)).xyz);
-
-    const M4 viewTrm {
-        right.x, up.x, lookAt.x, 0,
-        right.y, up.y, lookAt.y, 0,
-        right.z, up.z, lookAt.z, 0,
-        0,       0,    0,        1,
-    };
-
-    g_camera.m_front = lookAt;
-    g_camera.m_right = right;
-    g_camera.m_view = viewTrm;
+    g_camera.updateView();
 }
 
 static void
@@ -53,6 +53,32 @@ struct Camera
         m_trm = m_view * adt::math::M4TranslationFrom(-m_pos);
     }
 
+    /* m_view, m_front and m_right from m_yaw and m_pitch */
+    void
+    updateView()
+    {
+        using namespace adt::math;
+
+        const M4 yawTrm = M4RotFrom(0, toRad(-m_yaw), 0);
+        const M4 pitchTrm = M4RotFrom(toRad(m_pitch), 0, 0);
+        const M4 axisTrm = yawTrm * pitchTrm;
+
+        const V3 right = V3Norm((axisTrm * V4From(CAMERA_RIGHT, 0.0f)).xyz);
+        const V3 up = V3Norm((axisTrm * V4From(CAMERA_UP, 0.0f)).xyz);
+        const V3 lookAt = V3Norm((axisTrm * V4From(CAMERA_FRONT, 0.0f)).xyz);
+
+        const M4 viewTrm {
+            right.x, up.x, lookAt.x, 0,
+            right.y, up.y, lookAt.y, 0,
+            right.z, up.z, lookAt.z, 0,
+            0,       0,    0,        1,
+        };
+
+        m_front = lookAt;
+        m_right = right;
+        m_view = viewTrm;
+    }
+
     adt::math::V3
     forwardVecNoY() const
     {
@@ -0,0 +1,119 @@
+#include "cpu.hh"
+
+#include "adt/logs.hh"
+#include "adt/utils.hh"
+
+#if defined _WIN32
+    #include <intrin.h>
+#else
+    #include <cpuid.h>
+#endif
+
+using namespace adt;
+
+namespace cpu
+{
+
+ISA g_eISA = ISA::SSE4_2;
+ISA g_eMaxISA = ISA::AVX512;
+
+/* baseline table until init() runs */
+const Kernels* g_pKernels = &g_kernelsSSE4_2;
+
+struct CPUIDRegs
+{
+    u32 eax {};
+    u32 ebx {};
+    u32 ecx {};
+    u32 edx {};
+};
+
+static CPUIDRegs
+cpuid(const u32 leaf, const u32 subleaf)
+{
+    CPUIDRegs res {};
+
+#if defined _WIN32
+    int aRegs[4] {};
+    __cpuidex(aRegs, static_cast<int>(leaf), static_cast<int>(subleaf));
+    res = {static_cast<u32>(aRegs[0]), static_cast<u32>(aRegs[1]), static_cast<u32>(aRegs[2]), static_cast<u32>(aRegs[3])};
+#else
+    __cpuid_count(leaf, subleaf, res.eax, res.ebx, res.ecx, res.edx);
+#endif
+
+    return res;
+}
+
+/* XCR0: which register states the os saves on context switches */
+static u64
+xgetbv0()
+{
+#if defined _WIN32
+    return _xgetbv(0);
+#else
+    u32 lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<u64>(hi) << 32) | lo;
+#endif
+}
+
+static ISA
+detectISA()
+{
+    const u32 maxLeaf = cpuid(0, 0).eax;
+    if (maxLeaf < 7) return ISA::SSE4_2;
+
+    const CPUIDRegs leaf1 = cpuid(1, 0);
+    const CPUIDRegs leaf7 = cpuid(7, 0);
+
+    const bool bOSXSave = leaf1.ecx & (1u << 27);
+    const bool bAVX = leaf1.ecx & (1u << 28);
+    const bool bFMA = leaf1.ecx & (1u << 12);
+    if (!bOSXSave || !bAVX || !bFMA) return ISA::SSE4_2;
+
+    const u64 xcr0 = xgetbv0();
+
+    /* xmm and ymm state */
+    if ((xcr0 & 0x6) != 0x6) return ISA::SSE4_2;
+
+    const bool bAVX2 = leaf7.ebx & (1u << 5);
+    if (!bAVX2) return ISA::SSE4_2;
+
+    /* opmask, upper halves of zmm0-15 and zmm16-31 state */
+    const bool bAVX512F = leaf7.ebx & (1u << 16);
+    const bool bAVX512BW = leaf7.ebx & (1u << 30);
+    if (bAVX512F && bAVX512BW && (xcr0 & 0xe0) == 0xe0)
+        return ISA::AVX512;
+
+    return ISA::AVX2;
+}
+
+void
+init()
+{
+    g_eISA = utils::min(detectISA(), g_eMaxISA);
+
+    switch (g_eISA)
+    {
+        case ISA::SSE4_2: g_pKernels = &g_kernelsSSE4_2; break;
+        case ISA::AVX2: g_pKernels = &g_kernelsAVX2; break;
+        case ISA::AVX512: g_pKernels = &g_kernelsAVX512; break;
+    }
+
+    LOG_GOOD("ISA: {}\n", ISAName(g_eISA));
+}
+
+const char*
+ISAName(const ISA eISA)
+{
+    switch (eISA)
+    {
+        case ISA::SSE4_2: return "SSE4.2";
+        case ISA::AVX2: return "AVX2";
+        case ISA::AVX512: return "AVX-512";
+    }
+
+    return "unknown";
+}
+
+} /* namespace cpu */
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "adt/Span.hh"
+#include "adt/Span2D.hh"
+#include "adt/math.hh"
+
+union ImagePixelRGBA;
+
+namespace cpu
+{
+
+/* Each level implies the ones before it. AVX512 means AVX512F + AVX512BW. */
+enum class ISA : adt::u8 { SSE4_2, AVX2, AVX512 };
+
+/* Kernels that get built once per ISA level (see kernels.inc), init() picks the best table the cpu can run. */
+struct Kernels
+{
+    void (*pfnFillI32)(adt::Span<adt::i32> sp, adt::i32 x);
+    void (*pfnFillF32)(adt::Span<adt::f32> sp, adt::f32 x);
+    void (*pfnSwapRedBlueRGBA)(adt::Span<ImagePixelRGBA> sp);
+
+    /* Fills the rect with non-temporal stores and fences, for memory that won't be read again soon. */
+    void (*pfnStreamFillI32)(adt::Span2D<adt::i32> sp, adt::i32 x);
+
+    /* True if trm puts all 8 corners of the box outside of the same clip plane, so nothing in it can be on screen.
+     * Planes are those of gl's -w <= z <= w volume, which contains the 0 <= z <= w one of the sw renderer. */
+    bool (*pfnBoxOffScreen)(const adt::math::M4& trm, const adt::math::V3& min, const adt::math::V3& max);
+};
+
+extern const Kernels g_kernelsSSE4_2;
+extern const Kernels g_kernelsAVX2;
+extern const Kernels g_kernelsAVX512;
+
+extern ISA g_eISA; /* detected level, capped by g_eMaxISA */
+extern ISA g_eMaxISA; /* --isa */
+
+extern const Kernels* g_pKernels;
+inline const Kernels& kernels() { return *g_pKernels; }
+
+/* Detects the ISA level with cpuid and xgetbv and selects the kernel tables, call before anything uses kernels(). */
+void init();
+
+const char* ISAName(ISA eISA);
+
+} /* namespace cpu */
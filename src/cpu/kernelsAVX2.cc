@@ -0,0 +1,23 @@
+/* Built with -mavx2 -mfma and ADT_AVX2 (see CMakeLists.txt). */
+
+#include "cpu.hh"
+
+#include "Image.hh"
+
+#include "adt/simd.hh"
+
+using namespace adt;
+
+namespace cpu::avx2
+{
+
+#include "kernels.inc"
+
+} /* namespace cpu::avx2 */
+
+namespace cpu
+{
+
+const Kernels g_kernelsAVX2 = avx2::KERNELS;
+
+} /* namespace cpu */
@@ -0,0 +1,23 @@
+/* Built with -mavx512f -mavx512bw -mavx2 -mfma, ADT_AVX2 and ADT_AVX512 (see CMakeLists.txt). */
+
+#include "cpu.hh"
+
+#include "Image.hh"
+
+#include "adt/simd.hh"
+
+using namespace adt;
+
+namespace cpu::avx512
+{
+
+#include "kernels.inc"
+
+} /* namespace cpu::avx512 */
+
+namespace cpu
+{
+
+const Kernels g_kernelsAVX512 = avx512::KERNELS;
+
+} /* namespace cpu */
@@ -0,0 +1,23 @@
+/* Built with the baseline flags. */
+
+#include "cpu.hh"
+
+#include "Image.hh"
+
+#include "adt/simd.hh"
+
+using namespace adt;
+
+namespace cpu::sse4_2
+{
+
+#include "kernels.inc"
+
+} /* namespace cpu::sse4_2 */
+
+namespace cpu
+{
+
+const Kernels g_kernelsSSE4_2 = sse4_2::KERNELS;
+
+} /* namespace cpu */
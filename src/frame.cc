@@ -9,6 +9,13 @@
 #include "adt/Vec.hh"
 #include "adt/logs.hh"
 #include "adt/defer.hh"
+#include "adt/sort.hh"
+
+#ifdef OPT_SW
+    #include "BMP.hh"
+    #include "cpu/cpu.hh"
+    #include "render/sw/sw.hh"
+#endif
 
 using namespace adt;
 
@@ -22,6 +29,17 @@ f64 g_gameTime {};
 StringFixed<128> g_sfFpsStatus;
 f64 g_maxFps = 0.0;
 
+int g_nBenchFrames = 300;
+const char* g_ntsBenchDumpDir {};
+
+static void
+updateFpsStatus(const isize nFrames, const f64 avgFrameTimeMS)
+{
+    char aBuff[128] {};
+    isize n = print::toSpan(aBuff, "FPS: {} | avg frame time: {:.3} ms\n", nFrames, avgFrameTimeMS);
+    g_sfFpsStatus = StringView{aBuff, n};
+}
+
 [[maybe_unused]] static void
 refresh(void* pArg)
 {
@@ -38,10 +56,30 @@ refresh(void* pArg)
 
     s_accumulator += g_frameTime;
 
+    /* frame callbacks, so the time between them is the frame time */
+    static isize s_nFrames = 0;
+    static f64 s_lastFpsUpdateTime = newTime;
+    ++s_nFrames;
+    if (newTime > s_lastFpsUpdateTime + 1.0)
+    {
+        updateFpsStatus(s_nFrames, (newTime - s_lastFpsUpdateTime) * 1000.0 / s_nFrames);
+        s_nFrames = 0;
+        s_lastFpsUpdateTime = newTime;
+    }
+
+    control::procInput();
+    ui::updateState();
+
     while (s_accumulator >= g_dt)
     {
-        game::updateState(pArena);
-        g_gameTime += g_dt;
+        control::g_camera.updatePos();
+
+        if (!control::g_bPauseSimulation)
+        {
+            game::updateState(pArena);
+            g_gameTime += g_dt;
+        }
+
         s_accumulator -= g_dt;
     }
 
@@ -53,8 +91,7 @@ eventLoop()
 {
 #ifdef OPT_SW
 
-    auto& win = app::window();
-    auto& renderer = app::renderer();
+    auto& win = app::windowInst();
 
     Arena frameArena(SIZE_1M);
     defer( frameArena.freeAll() );
@@ -144,11 +181,7 @@ renderLoop(Arena* pArena)
             f64 avg = 0;
             for (const f64 ft : vFrameTimes) avg += ft;
 
-            char aBuff[128] {};
-            isize n = print::toSpan(aBuff, "FPS: {} | avg frame time: {:.3} ms\n",
-                vFrameTimes.size(), avg / vFrameTimes.size()
-            );
-            g_sfFpsStatus = StringView{aBuff, n};
+            updateFpsStatus(vFrameTimes.size(), avg / vFrameTimes.size());
 
             vFrameTimes.setSize(0);
             lastAvgFrameTimeUpdateTime = timer1;
@@ -156,6 +189,101 @@ renderLoop(Arena* pArena)
     }
 }
 
+#ifdef OPT_SW
+
+/* Same path for every run: an arc in front of the models, swinging the view across them. */
+static void
+benchCamera(const int frameI)
+{
+    auto& camera = control::g_camera;
+    const f32 t = static_cast<f32>(frameI) / static_cast<f32>(utils::max(g_nBenchFrames - 1, 1));
+    const f32 angle = (0.2f + 0.6f*t) * math::PI32;
+
+    camera.m_pos = {-3.0f + 10.0f*std::cos(angle), 1.0f, 5.0f - 10.0f*std::sin(angle)};
+    camera.m_yaw = math::toDeg(std::atan2(-3.0f - camera.m_pos.x, 5.0f - camera.m_pos.z)) + 15.0f*std::sin(4.0f*angle);
+    camera.m_pitch = 10.0f;
+    camera.updateView();
+    camera.m_trm = camera.m_view * math::M4TranslationFrom(-camera.m_pos);
+}
+
+/* Renders g_nBenchFrames with a fixed time step, then prints frame time stats. */
+static void
+headlessLoop()
+{
+    auto& win = app::windowInst();
+    auto& renderer = app::rendererInst();
+
+    Arena frameArena {SIZE_1M};
+    defer( frameArena.freeAll() );
+
+    VecManaged<f64> vFrameTimes(g_nBenchFrames);
+    defer( vFrameTimes.destroy() );
+
+    /* animations advance by the same amount every frame, so runs are comparable */
+    g_frameTime = 1.0 / 60.0;
+    game::updateState(&frameArena);
+
+    for (int frameI = 0; frameI < g_nBenchFrames; ++frameI)
+    {
+        benchCamera(frameI);
+
+        const f64 timer0 = utils::timeNowMS();
+
+        game::updateState(&frameArena);
+        g_gameTime += g_frameTime;
+        renderer.draw(&frameArena);
+
+        vFrameTimes.push(utils::timeNowMS() - timer0);
+
+        frameArena.shrinkToFirstBlock();
+        frameArena.reset();
+
+        if (g_ntsBenchDumpDir)
+        {
+            char aPath[512] {};
+            print::toSpan(aPath, "{}/frame{}.bmp", g_ntsBenchDumpDir, frameI);
+            BMP::writeToFile(win.surfaceBuffer(), aPath);
+        }
+    }
+
+    if (vFrameTimes.empty()) return;
+
+    f64 sum = 0.0;
+    for (const f64 ft : vFrameTimes) sum += ft;
+    const f64 avg = sum / vFrameTimes.size();
+
+    sort::quick(&vFrameTimes);
+    const isize p99I = utils::min((vFrameTimes.size() * 99) / 100, vFrameTimes.size() - 1);
+
+    print::out("frames: {}, size: {}x{}, isa: {}, depth: {}\n",
+        vFrameTimes.size(), win.m_width, win.m_height, cpu::ISAName(cpu::g_eISA), render::sw::depthFormatName(render::sw::g_eDepthFormat)
+    );
+    print::out("frame time ms: min: {:.3}, avg: {:.3}, p99: {:.3}, max: {:.3}\n",
+        vFrameTimes.first(), avg, vFrameTimes[p99I], vFrameTimes.last()
+    );
+
+    if (render::sw::g_frameBudgetMS > 0.0f)
+        print::out("frame budget ms: {:.3}, render scale: {:.3}\n", render::sw::g_frameBudgetMS, render::sw::renderScale());
+
+    if (render::sw::g_bVisibilityBuffer)
+        print::out("visibility buffer: on\n");
+
+    if (render::sw::g_bTrilinearFiltering)
+        print::out("trilinear filtering: on\n");
+
+    if (render::sw::g_bPostProcess)
+        print::out("post-process: on, exposure: {:.3}\n", render::sw::g_exposure);
+
+    if (render::sw::g_bShadows)
+    {
+        if (render::sw::g_eDepthFormat == render::sw::DEPTH_FORMAT::UNORM16)
+            print::out("shadows: off, unorm16 depth is too coarse\n");
+        else print::out("shadows: on\n");
+    }
+}
+
+#endif /* OPT_SW */
+
 static void
 mainLoop()
 {
@@ -198,6 +326,12 @@ start()
         eventLoop();
         break;
 
+#ifdef OPT_SW
+        case app::WINDOW_TYPE::HEADLESS:
+        headlessLoop();
+        break;
+#endif
+
         default:
         mainLoop();
         break;
@@ -16,6 +16,10 @@ extern adt::f64 g_gameTime; /* game time */
 extern adt::StringFixed<128> g_sfFpsStatus;
 extern adt::f64 g_maxFps;
 
+/* --headless benchmark */
+extern int g_nBenchFrames;
+extern const char* g_ntsBenchDumpDir; /* writes every frame as bmp if set */
+
 void start();
 
 } /* namespace frame */
@@ -139,6 +139,20 @@ Model::read(IAllocator* pAlloc, const json::Parser& parsed, const StringView svP
     return true;
 }
 
+bool
+Model::positionBounds(const Primitive& primitive, math::V3* pMin, math::V3* pMax) const
+{
+    if (primitive.attributes.POSITION < 0) return false;
+
+    const Accessor& acc = m_vAccessors[primitive.attributes.POSITION];
+    if (!acc.bMinMax || acc.eType != Accessor::TYPE::VEC3) return false;
+
+    *pMin = acc.uMin.VEC3;
+    *pMax = acc.uMax.VEC3;
+
+    return true;
+}
+
 bool
 Model::procToplevelObjs(IAllocator*, const json::Parser& parser)
 {
@@ -400,6 +414,7 @@ Model::procAccessors(IAllocator* pAlloc)
             .count = static_cast<int>(json::getInteger(pCount)),
             .uMax = pMax ? accessorTypeToUnionType(eType, pMax) : Type{},
             .uMin = pMin ? accessorTypeToUnionType(eType, pMin) : Type{},
+            .bMinMax = pMax && pMin,
             .eType = eType
         });
     }
@@ -620,6 +635,14 @@ Model::procMaterials(IAllocator* pAlloc)
             newMaterial.normalTexture.index = json::getInteger(pIndex);
         }
 
+        auto pAlphaMode = json::searchNode(obj, "alphaMode");
+        if (pAlphaMode)
+        {
+            const StringView svMode = json::getString(pAlphaMode);
+            if (svMode == "MASK") newMaterial.eAlphaMode = Material::ALPHA_MODE::MASK;
+            else if (svMode == "BLEND") newMaterial.eAlphaMode = Material::ALPHA_MODE::BLEND;
+        }
+
         m_vMaterials.push(pAlloc, newMaterial);
     }
 
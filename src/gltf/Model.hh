@@ -36,6 +36,9 @@ struct Model
 
     bool read(adt::IAllocator* pAlloc, const json::Parser& parsed, const adt::StringView svPath); /* clones uri */
 
+    /* Object space bounding box of the primitive from its POSITION accessor, false if the file doesn't have one. */
+    bool positionBounds(const Primitive& primitive, adt::math::V3* pMin, adt::math::V3* pMax) const;
+
     /* NOTE: (unsafe) make sure T is the correct type, and accessorI isn't out of bounds. */
     template<typename T>
     adt::View<T>
@@ -80,6 +80,7 @@ struct Accessor
     int count {}; /* REQUIRED The number of elements referenced by this accessor, not to be confused with the number of bytes or number of components. */
     Type uMax {}; /* number [1-16]. Maximum value of each component in this accessor. */
     Type uMin {}; /* number [1-16]. Minimum value of each component in this accessor. */
+    bool bMinMax {}; /* Both max and min were given, they are optional for anything but POSITION. */
     TYPE eType {}; /* REQUIRED. Specifies if the accessor’s elements are scalars, vectors, or matrices. */
 };
 
@@ -264,9 +265,15 @@ struct PbrMetallicRoughness
 
 struct Material
 {
+    /* NONE is "OPAQUE" in the spec, wingdi.h defines that one. */
+    enum class ALPHA_MODE : adt::u8 { NONE, MASK, BLEND };
+
+    /* */
+
     adt::String sName {};
     PbrMetallicRoughness pbrMetallicRoughness {};
     NormalTextureInfo normalTexture {};
+    ALPHA_MODE eAlphaMode = ALPHA_MODE::NONE;
 };
 
 struct Skin
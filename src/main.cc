@@ -1,12 +1,20 @@
 #include "app.hh"
+#include "cpu/cpu.hh"
 #include "frame.hh"
 
+#ifdef OPT_SW
+    #include "render/sw/sw.hh"
+#endif
+
 #include "adt/String.hh"
 #include "adt/FreeList.hh"
 #include "adt/defer.hh"
 
 using namespace adt;
 
+static int s_startWidth = 1280;
+static int s_startHeight = 720;
+
 static int startup(int argc, char** argv);
 
 #if defined _WIN32 && defined NDEBUG
@@ -55,6 +63,86 @@ parseArgs(const int argc, const char* const argv[])
                 app::g_eWindowType = app::WINDOW_TYPE::WINDOWS;
                 app::g_eRendererType = app::RENDERER_TYPE::OPEN_GL;
             }
+            else if (svArg == "--isa" && i + 1 < argc)
+            {
+                /* caps the detected level, to compare kernels on one machine */
+                const StringView svISA = argv[++i];
+                if (svISA == "sse4.2") cpu::g_eMaxISA = cpu::ISA::SSE4_2;
+                else if (svISA == "avx2") cpu::g_eMaxISA = cpu::ISA::AVX2;
+                else if (svISA == "avx512") cpu::g_eMaxISA = cpu::ISA::AVX512;
+            }
+            else if (svArg == "--headless")
+            {
+                app::g_eWindowType = app::WINDOW_TYPE::HEADLESS;
+                /* both cpu renderers can go headless */
+                if (app::g_eRendererType != app::RENDERER_TYPE::RAY_TRACE)
+                    app::g_eRendererType = app::RENDERER_TYPE::SW;
+            }
+            else if (svArg == "--frames" && i + 1 < argc)
+            {
+                frame::g_nBenchFrames = static_cast<int>(StringView(argv[++i]).toI64());
+            }
+            else if (svArg == "--size" && i + 1 < argc)
+            {
+                /* WxH */
+                const char* ntsSize = argv[++i];
+                const isize xI = StringView(ntsSize).firstOf('x');
+                if (xI > 0)
+                {
+                    /* strtoll stops at the 'x' */
+                    const int width = static_cast<int>(StringView(ntsSize).toI64());
+                    const int height = static_cast<int>(StringView(ntsSize + xI + 1).toI64());
+                    if (width > 0 && height > 0)
+                    {
+                        s_startWidth = width;
+                        s_startHeight = height;
+                    }
+                }
+            }
+            else if (svArg == "--dump" && i + 1 < argc)
+            {
+                frame::g_ntsBenchDumpDir = argv[++i];
+            }
+#ifdef OPT_SW
+            else if (svArg == "--depth" && i + 1 < argc)
+            {
+                const StringView svFormat = argv[++i];
+                if (svFormat == "f32") render::sw::g_eDepthFormat = render::sw::DEPTH_FORMAT::F32;
+                else if (svFormat == "unorm16") render::sw::g_eDepthFormat = render::sw::DEPTH_FORMAT::UNORM16;
+                else if (svFormat == "unorm24s8") render::sw::g_eDepthFormat = render::sw::DEPTH_FORMAT::UNORM24_STENCIL8;
+            }
+            else if (svArg == "--frame-budget" && i + 1 < argc)
+            {
+                render::sw::g_frameBudgetMS = static_cast<f32>(StringView(argv[++i]).toF64());
+            }
+            else if (svArg == "--visibility-buffer")
+            {
+                render::sw::g_bVisibilityBuffer = true;
+            }
+            else if (svArg == "--trilinear")
+            {
+                render::sw::g_bTrilinearFiltering = true;
+            }
+            else if (svArg == "--post-process")
+            {
+                render::sw::g_bPostProcess = true;
+            }
+            else if (svArg == "--exposure" && i + 1 < argc)
+            {
+                render::sw::g_exposure = static_cast<f32>(StringView(argv[++i]).toF64());
+            }
+            else if (svArg == "--shadows")
+            {
+                render::sw::g_bShadows = true;
+            }
+            else if (svArg == "--ray-trace")
+            {
+                /* draws into the same cpu buffers as the sw renderer */
+                if (app::g_eWindowType != app::WINDOW_TYPE::HEADLESS)
+                    app::g_eWindowType = app::WINDOW_TYPE::WAYLAND_SHM;
+                app::g_eRendererType = app::RENDERER_TYPE::RAY_TRACE;
+            }
+#endif
         }
         else return;
     }
@@ -72,6 +160,7 @@ startup(int argc, char* argv[])
     app::g_eRendererType = app::RENDERER_TYPE::OPEN_GL;
 
     parseArgs(argc, argv);
+    cpu::init();
 
     try
     {
@@ -83,7 +172,7 @@ startup(int argc, char* argv[])
         app::g_pWindow = app::allocWindow(&allocator, ntsName);
         app::g_pRenderer = app::allocRenderer(&allocator);
 
-        app::g_pWindow->start(1280, 720);
+        app::g_pWindow->start(s_startWidth, s_startHeight);
         defer( app::g_pWindow->destroy() );
 
         frame::start();
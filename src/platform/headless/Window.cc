@@ -0,0 +1,38 @@
+#include "Window.hh"
+
+#include "adt/logs.hh"
+
+using namespace adt;
+
+namespace platform::headless
+{
+
+void
+Window::start(int width, int height)
+{
+    m_winWidth = m_realWidth = m_width = width;
+    m_winHeight = m_realHeight = m_height = height;
+    m_stride = m_width + 15; /* simd padding, up to 16 wide row groups */
+
+    m_vSurfaceBuffer.setSize(m_pAlloc, m_stride * m_height);
+    allocDepthBuffers();
+
+    LOG_GOOD("headless window started: {}x{}\n", m_width, m_height);
+}
+
+void
+Window::destroy()
+{
+    m_vSurfaceBuffer.destroy(m_pAlloc);
+    m_vDepthBuffer.destroy(m_pAlloc);
+    m_vHiZBuffer.destroy(m_pAlloc);
+    m_vVisibilityBuffer.destroy(m_pAlloc);
+}
+
+Span2D<ImagePixelRGBA>
+Window::surfaceBuffer()
+{
+    return {m_vSurfaceBuffer.data(), m_width, m_height, m_stride};
+}
+
+} /* namespace platform::headless */
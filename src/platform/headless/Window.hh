@@ -0,0 +1,42 @@
+#pragma once
+
+#include "IWindow.hh"
+
+namespace platform::headless
+{
+
+/* Plain memory render target for the SW renderer, no display, no input. */
+struct Window : public IWindow
+{
+    adt::Vec<ImagePixelRGBA> m_vSurfaceBuffer {};
+
+    /* */
+
+    Window() = default;
+    Window(adt::IAllocator* pAlloc, const char* ntsName) : IWindow(pAlloc, ntsName) {}
+
+    /* */
+
+    virtual void start(int width, int height) override;
+    virtual void disableRelativeMode() override {}
+    virtual void enableRelativeMode() override {}
+    virtual void togglePointerRelativeMode() override {}
+    virtual void toggleFullscreen() override {}
+    virtual void hideCursor(bool) override {}
+    virtual void setCursorImage(adt::StringView) override {}
+    virtual void setFullscreen() override {}
+    virtual void unsetFullscreen() override {}
+    virtual void setSwapInterval(int) override {}
+    virtual void toggleVSync() override {}
+    virtual void swapBuffers() override {}
+    virtual void procEvents() override {}
+    virtual void showWindow() override {}
+    virtual void destroy() override;
+    virtual void bindContext() override {}
+    virtual void unbindContext() override {}
+
+    virtual adt::Span2D<ImagePixelRGBA> surfaceBuffer() override;
+    virtual void scheduleFrame() override {}
+};
+
+} /* namespace platform::headless */
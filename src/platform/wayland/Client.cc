@@ -28,6 +28,10 @@ static const wl_shm_listener s_shmListener {
     .format = reinterpret_cast<decltype(wl_shm_listener::format)>(methodPointerNonVirtual(&Client::shmFormat))
 };
 
+static const wl_buffer_listener s_bufferListener {
+    .release = reinterpret_cast<decltype(wl_buffer_listener::release)>(methodPointerNonVirtual(&Client::bufferRelease))
+};
+
 static const xdg_wm_base_listener s_xdgWmBaseListener {
     .ping = reinterpret_cast<decltype(xdg_wm_base_listener::ping)>(methodPointerNonVirtual(&Client::xdgWmBasePing))
 };
@@ -158,7 +162,11 @@ Client::start(int width, int height)
 {
     m_winWidth = m_width = width;
     m_winHeight = m_height = height;
-    m_stride = m_width + 7; /* NOTE: simd padding */
+    m_stride = m_width + 15; /* NOTE: simd padding, up to 16 wide row groups */
+#ifdef OPT_SW
+    m_presentWidth = m_width;
+    m_presentHeight = m_height;
+#endif
 
     wp_viewport_set_source(m_pViewport,
         wl_fixed_from_int(0), wl_fixed_from_int(0),
@@ -298,7 +306,9 @@ Client::destroy()
     for (auto& output : m_vOutputs) wl_output_destroy(output);
     if (m_pShm) wl_shm_destroy(m_pShm);
     if (m_pShmPool) wl_shm_pool_destroy(m_pShmPool);
-    if (m_pBuffer) wl_buffer_destroy(m_pBuffer);
+    for (ShmBuffer& buff : m_aBuffers)
+        if (buff.pBuffer) wl_buffer_destroy(buff.pBuffer);
+    if (m_pBufferQueue) wl_event_queue_destroy(m_pBufferQueue);
     if (m_pSeat) wl_seat_destroy(m_pSeat);
     if (m_pKeyboard) wl_keyboard_destroy(m_pKeyboard);
     if (m_pPointer) wl_pointer_destroy(m_pPointer);
@@ -355,26 +365,97 @@ Client::scheduleFrame()
     updateSurface();
 }
 
+/* The compositor does the upscale, the viewport destination already follows the window size. */
+bool
+Client::presentRect(int width, int height)
+{
+    if (width == m_presentWidth && height == m_presentHeight) return true;
+
+    m_presentWidth = width;
+    m_presentHeight = height;
+
+    wp_viewport_set_source(m_pViewport,
+        wl_fixed_from_int(0), wl_fixed_from_int(0),
+        wl_fixed_from_int(width), wl_fixed_from_int(height)
+    );
+
+    return true;
+}
+
+void
+Client::damageRect(int x, int y, int width, int height)
+{
+    m_vDamage.push(m_pAlloc, {.x = x, .y = y, .width = width, .height = height});
+}
+
 void
 Client::updateSurface()
 {
     /* flip the image... */
     {
+        /* only the presented rows */
         auto sp = surfaceBuffer();
         u32* pTemp = reinterpret_cast<u32*>(m_vTempBuff.data());
-        const int heightOver2 = sp.getHeight() / 2;
+        const int heightOver2 = m_presentHeight / 2;
 
         for (int y = 0; y < heightOver2; ++y)
         {
-            utils::copy(pTemp, &sp(0, y).data, sp.getStride());
-            utils::copy(&sp(0, y).data, &sp(0, sp.getHeight() - y - 1).data, sp.getStride());
-            utils::copy(&sp(0, sp.getHeight() - y - 1).data, pTemp, sp.getStride());
+            utils::copy(pTemp, &sp(0, y).data, sp.stride());
+            utils::copy(&sp(0, y).data, &sp(0, m_presentHeight - y - 1).data, sp.stride());
+            utils::copy(&sp(0, m_presentHeight - y - 1).data, pTemp, sp.stride());
         }
     }
 
-    wl_surface_attach(m_pSurface, m_pBuffer, 0, 0);
-    wl_surface_damage(m_pSurface, 0, 0, m_winWidth, m_winHeight);
+    ShmBuffer& buff = m_aBuffers[m_bufferI];
+    wl_surface_attach(m_pSurface, buff.pBuffer, 0, 0);
+
+    if (wl_surface_get_version(m_pSurface) >= WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION)
+    {
+        /* the buffer is flipped now, rows go top down */
+        for (const DamageRect& rect : m_vDamage)
+            wl_surface_damage_buffer(m_pSurface, rect.x, m_presentHeight - rect.y - rect.height, rect.width, rect.height);
+    }
+    else
+    {
+        wl_surface_damage(m_pSurface, 0, 0, m_winWidth, m_winHeight);
+    }
+
+    m_vDamage.setSize(m_pAlloc, 0);
+
     wl_surface_commit(m_pSurface);
+    buff.bBusy = true;
+
+    acquireBuffer();
+}
+
+/* Binds surfaceBuffer() to a buffer the compositor is done reading.
+ * With N_BUFFERS there is normally one free already, otherwise wait for a release. */
+void
+Client::acquireBuffer()
+{
+    auto clFindFree = [&]
+    {
+        for (int i = 0; i < N_BUFFERS; ++i)
+        {
+            if (!m_aBuffers[i].bBusy)
+            {
+                m_bufferI = i;
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    wl_display_dispatch_queue_pending(m_pDisplay, m_pBufferQueue);
+
+    while (!clFindFree())
+    {
+        int ok = wl_display_dispatch_queue(m_pDisplay, m_pBufferQueue);
+        ADT_ASSERT_ALWAYS(ok != -1, "wl_display_dispatch_queue() failed");
+    }
+
+    m_pSurfaceBufferBind = m_aBuffers[m_bufferI].pData;
 }
 
 #endif
@@ -628,13 +709,24 @@ Client::callbackDone(
 #endif
 }
 
+void
+Client::bufferRelease(wl_buffer* pBuffer)
+{
+    for (ShmBuffer& buff : m_aBuffers)
+    {
+        if (buff.pBuffer == pBuffer)
+            buff.bBusy = false;
+    }
+}
+
 void
 Client::initShm()
 {
     wl_shm_add_listener(m_pShm, &s_shmListener, this);
 
     const int stride = m_stride * 4;
-    const int shmPoolSize = m_height * stride;
+    const int bufferSize = m_height * stride;
+    const int shmPoolSize = bufferSize * N_BUFFERS;
 
     int fd = shm::allocFile(shmPoolSize);
     m_pPoolData = static_cast<u8*>(mmap(nullptr, shmPoolSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
@@ -644,13 +736,25 @@ Client::initShm()
     m_pShmPool = wl_shm_create_pool(m_pShm, fd, shmPoolSize);
     ADT_ASSERT_ALWAYS(m_pShmPool, "wl_shm_create_pool() failed");
 
-    m_pBuffer = wl_shm_pool_create_buffer(m_pShmPool, 0, m_width, m_height, stride, WL_SHM_FORMAT_ARGB8888);
-    ADT_ASSERT_ALWAYS(m_pBuffer, "wl_shm_pool_create_buffer() failed");
+    m_pBufferQueue = wl_display_create_queue(m_pDisplay);
+    ADT_ASSERT_ALWAYS(m_pBufferQueue, "wl_display_create_queue() failed");
+
+    for (int i = 0; i < N_BUFFERS; ++i)
+    {
+        ShmBuffer& buff = m_aBuffers[i];
+
+        buff.pBuffer = wl_shm_pool_create_buffer(m_pShmPool, i * bufferSize, m_width, m_height, stride, WL_SHM_FORMAT_ARGB8888);
+        ADT_ASSERT_ALWAYS(buff.pBuffer, "wl_shm_pool_create_buffer() failed");
+        buff.pData = m_pPoolData + i*bufferSize;
+
+        wl_proxy_set_queue(reinterpret_cast<wl_proxy*>(buff.pBuffer), m_pBufferQueue);
+        wl_buffer_add_listener(buff.pBuffer, &s_bufferListener, this);
+    }
 
 #ifdef OPT_SW
-    m_vTempBuff.setSize(m_pAlloc, surfaceBuffer().getStride());
-    m_vDepthBuffer.setSize(m_pAlloc, m_stride * m_height);
-    m_pSurfaceBufferBind = m_pPoolData;
+    m_vTempBuff.setSize(m_pAlloc, surfaceBuffer().stride());
+    allocDepthBuffers();
+    m_pSurfaceBufferBind = m_aBuffers[m_bufferI].pData;
 #endif
 
     LOG_GOOD("wayland shm client started...\n");
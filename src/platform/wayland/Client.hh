@@ -24,11 +24,31 @@ struct Client : public IWindow
 
     adt::Vec<wl_output*> m_vOutputs {};
 
+    /* SHM swapchain, the renderer draws into a buffer the compositor has released while it reads the last one. */
+    static constexpr int N_BUFFERS = 3;
+
+    struct ShmBuffer
+    {
+        wl_buffer* pBuffer {};
+        adt::u8* pData {};
+        bool bBusy {}; /* attached, waiting for wl_buffer.release */
+    };
+
+    struct DamageRect
+    {
+        int x {};
+        int y {};
+        int width {};
+        int height {};
+    };
+
     wl_shm* m_pShm {};
     wl_shm_pool* m_pShmPool {};
     adt::u8* m_pPoolData {};
     adt::isize m_poolSize {};
-    wl_buffer* m_pBuffer {};
+    ShmBuffer m_aBuffers[N_BUFFERS] {};
+    int m_bufferI {}; /* m_aBuffers entry behind surfaceBuffer() */
+    wl_event_queue* m_pBufferQueue {}; /* only wl_buffer.release, waiting on it doesn't run frame callbacks */
 
     wl_seat* m_pSeat {};
     wl_keyboard* m_pKeyboard {};
@@ -92,13 +112,19 @@ struct Client : public IWindow
     wl_callback* m_pCallBack {};
     adt::u8* m_pSurfaceBufferBind {};
     adt::Vec<ImagePixelRGBA> m_vTempBuff {};
+    int m_presentWidth {}; /* wp_viewport source rect */
+    int m_presentHeight {};
+    adt::Vec<DamageRect> m_vDamage {}; /* for the next commit, buffer rows bottom first */
 
     virtual adt::Span2D<ImagePixelRGBA> surfaceBuffer() override;
     virtual void scheduleFrame() override;
+    virtual bool presentRect(int width, int height) override;
+    virtual void damageRect(int x, int y, int width, int height) override;
 
     /* */
 
     void updateSurface();
+    void acquireBuffer();
 #endif
 
     /* */
@@ -157,6 +183,7 @@ struct Client : public IWindow
     /* */
 
     void callbackDone(wl_callback* pCallback, uint32_t callbackData);
+    void bufferRelease(wl_buffer* pBuffer);
     void initShm();
 };
 
@@ -24,7 +24,7 @@ ClientGL::start(int width, int height)
 {
     m_winWidth = m_width = width;
     m_winHeight = m_height = height;
-    m_stride = m_width + 7; /* NOTE: simd padding */
+    m_stride = m_width + 15; /* NOTE: simd padding, up to 16 wide row groups */
 
     initGL();
 }
@@ -162,7 +162,7 @@ Window::start(int width, int height)
 
     m_winWidth = m_width = width;
     m_winHeight = m_height = height;
-    m_stride = m_width + 7; /* simd padding */
+    m_stride = m_width + 15; /* simd padding, up to 16 wide row groups */
 
     m_windowClass = {};
     m_windowClass.cbSize = sizeof(m_windowClass);
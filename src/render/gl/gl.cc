@@ -6,6 +6,7 @@
 #include "asset.hh"
 #include "common.hh"
 #include "control.hh"
+#include "cpu/cpu.hh"
 #include "game/game.hh"
 #include "shaders/glsl.hh"
 
@@ -312,6 +313,15 @@ drawNode(const Model& model, const Model::Node& node, const math::M4& trm, const
             if (!control::g_bPauseSimulation)
                 ((Future<Empty>&)model.m_future).wait();
 
+            /* after the wait, animation moves the nodes. Bind pose bounds don't hold for skinned primitives. */
+            V3 boundsMin, boundsMax;
+            if (primitive.attributes.JOINTS_0 < 0 && gltfModel.positionBounds(primitive, &boundsMin, &boundsMax) &&
+                cpu::kernels().pfnBoxOffScreen(trmProj * trmView * trm * node.finalTransform, boundsMin, boundsMax)
+            )
+            {
+                continue;
+            }
+
             if (primitive.attributes.JOINTS_0 > -1)
             {
                 ADT_ASSERT(primitive.attributes.WEIGHTS_0 > -1, "must have");
@@ -0,0 +1,347 @@
+#include "bvh.hh"
+
+#include "kernels.hh"
+
+#include <limits>
+
+using namespace adt;
+
+namespace render::rt
+{
+
+/* Centroid bins per axis of a SAH split search. */
+constexpr int N_SAH_BINS = 16;
+
+/* Cost of visiting an inner node relative to one triangle test. */
+constexpr f32 SAH_TRAVERSAL_COST = 1.0f;
+
+constexpr f32 F32_MAX = std::numeric_limits<f32>::max();
+
+static math::V3
+V3Min(const math::V3 l, const math::V3 r)
+{
+    return {utils::min(l.x, r.x), utils::min(l.y, r.y), utils::min(l.z, r.z)};
+}
+
+static math::V3
+V3Max(const math::V3 l, const math::V3 r)
+{
+    return {utils::max(l.x, r.x), utils::max(l.y, r.y), utils::max(l.z, r.z)};
+}
+
+/* Half of the surface area, SAH only compares ratios. */
+static f32
+halfArea(const math::V3 boundsMin, const math::V3 boundsMax)
+{
+    const math::V3 d = boundsMax - boundsMin;
+    return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+struct SahBin
+{
+    math::V3 boundsMin {F32_MAX, F32_MAX, F32_MAX};
+    math::V3 boundsMax {-F32_MAX, -F32_MAX, -F32_MAX};
+    int nItems {};
+};
+
+void
+buildBvh(IAllocator* pAlloc, Vec<BvhNode>* pVNodes, Vec<u32>* pVItemIs, const Span<const BvhNode> spItems)
+{
+    const isize nItems = spItems.size();
+
+    pVNodes->setSize(pAlloc, 0);
+    pVItemIs->setSize(pAlloc, nItems);
+    if (nItems == 0) return;
+
+    Vec<math::V3> vCentroids {pAlloc, nItems};
+    ADT_DEFER( vCentroids.destroy(pAlloc) );
+    vCentroids.setSize(pAlloc, nItems);
+
+    for (isize i = 0; i < nItems; ++i)
+    {
+        (*pVItemIs)[i] = static_cast<u32>(i);
+        vCentroids[i] = (spItems[i].boundsMin + spItems[i].boundsMax) * 0.5f;
+    }
+
+    /* a node's firstI and nItems are its item range until it gets split */
+    pVNodes->push(pAlloc, {.firstI = 0, .nItems = static_cast<u32>(nItems)});
+
+    struct StackEntry { u32 nodeI; int depth; };
+    Vec<StackEntry> vStack {pAlloc, BVH_MAX_DEPTH};
+    ADT_DEFER( vStack.destroy(pAlloc) );
+    vStack.push(pAlloc, {0, 0});
+
+    while (!vStack.empty())
+    {
+        const auto [nodeI, depth] = vStack.pop();
+        const u32 firstI = (*pVNodes)[nodeI].firstI;
+        const u32 n = (*pVNodes)[nodeI].nItems;
+        u32* pItemIs = pVItemIs->data() + firstI;
+
+        math::V3 boundsMin {F32_MAX, F32_MAX, F32_MAX}, boundsMax {-F32_MAX, -F32_MAX, -F32_MAX};
+        math::V3 centroidMin = boundsMin, centroidMax = boundsMax;
+        for (u32 i = 0; i < n; ++i)
+        {
+            const BvhNode& item = spItems[pItemIs[i]];
+            boundsMin = V3Min(boundsMin, item.boundsMin);
+            boundsMax = V3Max(boundsMax, item.boundsMax);
+            centroidMin = V3Min(centroidMin, vCentroids[pItemIs[i]]);
+            centroidMax = V3Max(centroidMax, vCentroids[pItemIs[i]]);
+        }
+
+        (*pVNodes)[nodeI].boundsMin = boundsMin;
+        (*pVNodes)[nodeI].boundsMax = boundsMax;
+
+        if (n <= BVH_MIN_LEAF_SIZE) continue;
+
+        /* best plane over every axis, in units of item area */
+        int bestAxis = -1;
+        int bestSplit = 0;
+        f32 bestCost = F32_MAX;
+        for (int axis = 0; depth < BVH_MAX_DEPTH / 2 && axis < 3; ++axis)
+        {
+            const f32 extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f) continue;
+
+            const f32 binScale = static_cast<f32>(N_SAH_BINS) / extent;
+            SahBin aBins[N_SAH_BINS] {};
+            for (u32 i = 0; i < n; ++i)
+            {
+                const BvhNode& item = spItems[pItemIs[i]];
+                const int binI = utils::min(
+                    static_cast<int>((vCentroids[pItemIs[i]][axis] - centroidMin[axis]) * binScale), N_SAH_BINS - 1
+                );
+                aBins[binI].boundsMin = V3Min(aBins[binI].boundsMin, item.boundsMin);
+                aBins[binI].boundsMax = V3Max(aBins[binI].boundsMax, item.boundsMax);
+                ++aBins[binI].nItems;
+            }
+
+            /* sweep from the right for the area and count right of every plane */
+            f32 aRightCosts[N_SAH_BINS] {};
+            SahBin right {};
+            for (int binI = N_SAH_BINS - 1; binI > 0; --binI)
+            {
+                right.boundsMin = V3Min(right.boundsMin, aBins[binI].boundsMin);
+                right.boundsMax = V3Max(right.boundsMax, aBins[binI].boundsMax);
+                right.nItems += aBins[binI].nItems;
+                aRightCosts[binI] = right.nItems > 0 ? halfArea(right.boundsMin, right.boundsMax) * right.nItems : 0.0f;
+            }
+
+            SahBin left {};
+            for (int splitI = 1; splitI < N_SAH_BINS; ++splitI)
+            {
+                left.boundsMin = V3Min(left.boundsMin, aBins[splitI - 1].boundsMin);
+                left.boundsMax = V3Max(left.boundsMax, aBins[splitI - 1].boundsMax);
+                left.nItems += aBins[splitI - 1].nItems;
+                if (left.nItems == 0 || left.nItems == static_cast<int>(n)) continue;
+
+                const f32 cost = halfArea(left.boundsMin, left.boundsMax) * left.nItems + aRightCosts[splitI];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = splitI;
+                }
+            }
+        }
+
+        const f32 area = halfArea(boundsMin, boundsMax);
+        const bool bSahSplit = bestAxis >= 0 && (area <= 0.0f || SAH_TRAVERSAL_COST + bestCost / area < static_cast<f32>(n));
+        if (!bSahSplit && n <= BVH_MAX_LEAF_SIZE) continue;
+
+        u32 nLeft = n / 2;
+        if (bestAxis >= 0)
+        {
+            /* partition by the best plane even if SAH would rather have a leaf, it's too big for one */
+            const f32 binScale = static_cast<f32>(N_SAH_BINS) / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+            u32 i = 0, j = n;
+            while (i < j)
+            {
+                const int binI = utils::min(
+                    static_cast<int>((vCentroids[pItemIs[i]][bestAxis] - centroidMin[bestAxis]) * binScale), N_SAH_BINS - 1
+                );
+
+                if (binI < bestSplit) ++i;
+                else utils::swap(&pItemIs[i], &pItemIs[--j]);
+            }
+
+            nLeft = i;
+        }
+        /* else every centroid is in the same spot (or the tree is too deep), any split is as good as the other */
+
+        const u32 childI = static_cast<u32>(pVNodes->size());
+        pVNodes->push(pAlloc, {.firstI = firstI, .nItems = nLeft});
+        pVNodes->push(pAlloc, {.firstI = firstI + nLeft, .nItems = n - nLeft});
+
+        (*pVNodes)[nodeI].firstI = childI;
+        (*pVNodes)[nodeI].nItems = 0;
+
+        vStack.push(pAlloc, {childI + 1, depth + 1});
+        vStack.push(pAlloc, {childI, depth + 1});
+    }
+}
+
+void
+Blas::build(IAllocator* pAlloc, const Span<const math::IV4> spTriangles)
+{
+    const isize nTriangles = spTriangles.size();
+
+    Vec<BvhNode> vItems {pAlloc, nTriangles};
+    ADT_DEFER( vItems.destroy(pAlloc) );
+    Vec<u32> vItemIs {};
+    ADT_DEFER( vItemIs.destroy(pAlloc) );
+
+    for (const math::IV4& tri : spTriangles)
+    {
+        const math::V3 p0 = vPositions[tri.x];
+        const math::V3 p1 = vPositions[tri.y];
+        const math::V3 p2 = vPositions[tri.z];
+
+        vItems.push(pAlloc, {
+            .boundsMin = V3Min(p0, V3Min(p1, p2)),
+            .boundsMax = V3Max(p0, V3Max(p1, p2)),
+        });
+    }
+
+    buildBvh(pAlloc, &vNodes, &vItemIs, {vItems.data(), vItems.size()});
+
+    vIndices.setSize(pAlloc, nTriangles);
+    vTriangles.setSize(pAlloc, nTriangles);
+    for (isize i = 0; i < nTriangles; ++i)
+        vIndices[i] = spTriangles[vItemIs[i]];
+
+    refit();
+}
+
+void
+Blas::refit()
+{
+    for (isize i = 0; i < vIndices.size(); ++i)
+    {
+        const math::IV4& tri = vIndices[i];
+        const math::V3 p0 = vPositions[tri.x];
+        vTriangles[i] = {.v0 = p0, .e1 = vPositions[tri.y] - p0, .e2 = vPositions[tri.z] - p0};
+    }
+
+    /* children come after their parents */
+    for (isize nodeI = vNodes.size() - 1; nodeI >= 0; --nodeI)
+    {
+        BvhNode& node = vNodes[nodeI];
+
+        if (node.nItems > 0)
+        {
+            math::V3 boundsMin {F32_MAX, F32_MAX, F32_MAX}, boundsMax {-F32_MAX, -F32_MAX, -F32_MAX};
+            for (u32 i = node.firstI; i < node.firstI + node.nItems; ++i)
+            {
+                const math::IV4& tri = vIndices[i];
+                for (int vertexI = 0; vertexI < 3; ++vertexI)
+                {
+                    boundsMin = V3Min(boundsMin, vPositions[tri.e[vertexI]]);
+                    boundsMax = V3Max(boundsMax, vPositions[tri.e[vertexI]]);
+                }
+            }
+
+            node.boundsMin = boundsMin;
+            node.boundsMax = boundsMax;
+        }
+        else
+        {
+            const BvhNode& left = vNodes[node.firstI];
+            const BvhNode& right = vNodes[node.firstI + 1];
+            node.boundsMin = V3Min(left.boundsMin, right.boundsMin);
+            node.boundsMax = V3Max(left.boundsMax, right.boundsMax);
+        }
+    }
+}
+
+void
+Blas::destroy(IAllocator* pAlloc) noexcept
+{
+    vNodes.destroy(pAlloc);
+    vTriangles.destroy(pAlloc);
+    vIndices.destroy(pAlloc);
+    vPositions.destroy(pAlloc);
+}
+
+void
+Scene::build(IAllocator* pAlloc)
+{
+    Vec<BvhNode> vItems {pAlloc, vInstances.size()};
+    ADT_DEFER( vItems.destroy(pAlloc) );
+
+    /* world bounds of the transformed corners of every root */
+    for (const Instance& inst : vInstances)
+    {
+        const BvhNode& root = inst.pBlas->vNodes[0];
+        math::V3 boundsMin {F32_MAX, F32_MAX, F32_MAX}, boundsMax {-F32_MAX, -F32_MAX, -F32_MAX};
+
+        for (int cornerI = 0; cornerI < 8; ++cornerI)
+        {
+            const math::V4 corner {
+                cornerI & 1 ? root.boundsMax.x : root.boundsMin.x,
+                cornerI & 2 ? root.boundsMax.y : root.boundsMin.y,
+                cornerI & 4 ? root.boundsMax.z : root.boundsMin.z,
+                1.0f,
+            };
+            const math::V3 world = (inst.trm * corner).xyz;
+            boundsMin = V3Min(boundsMin, world);
+            boundsMax = V3Max(boundsMax, world);
+        }
+
+        vItems.push(pAlloc, {.boundsMin = boundsMin, .boundsMax = boundsMax});
+    }
+
+    buildBvh(pAlloc, &vNodes, &vInstanceIs, {vItems.data(), vItems.size()});
+}
+
+void
+Scene::destroy(IAllocator* pAlloc) noexcept
+{
+    vInstances.destroy(pAlloc);
+    vNodes.destroy(pAlloc);
+    vInstanceIs.destroy(pAlloc);
+}
+
+static RayPacket
+singleRayPacket(const Ray& ray)
+{
+    /* every other lane has tMax 0 */
+    RayPacket rays {};
+    rays.aOriginX[0] = ray.origin.x;
+    rays.aOriginY[0] = ray.origin.y;
+    rays.aOriginZ[0] = ray.origin.z;
+    rays.aDirX[0] = ray.dir.x;
+    rays.aDirY[0] = ray.dir.y;
+    rays.aDirZ[0] = ray.dir.z;
+    rays.aTMax[0] = ray.tMax;
+
+    return rays;
+}
+
+Hit
+intersect(const Scene& scene, const Ray& ray)
+{
+    const RayPacket rays = singleRayPacket(ray);
+    PacketHits hits {};
+    kernels().pfnIntersect(scene, rays, &hits);
+
+    return {
+        .t = hits.aT[0],
+        .u = hits.aU[0],
+        .v = hits.aV[0],
+        .instanceI = hits.aInstanceIs[0],
+        .triangleI = hits.aTriangleIs[0],
+    };
+}
+
+bool
+occluded(const Scene& scene, const Ray& ray)
+{
+    const RayPacket rays = singleRayPacket(ray);
+    alignas(64) i32 aOccluded[MAX_PACKET_SIZE] {};
+    kernels().pfnOccluded(scene, rays, aOccluded);
+
+    return aOccluded[0] != 0;
+}
+
+} /* namespace render::rt */
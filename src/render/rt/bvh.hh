@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Image.hh"
+
+#include "adt/Vec.hh"
+#include "adt/View.hh"
+#include "adt/math.hh"
+
+namespace render::rt
+{
+
+/* Children of an inner node are adjacent: firstI and firstI + 1, always after their parent.
+ * Leaves have nItems > 0 and index their items with firstI. */
+struct BvhNode
+{
+    adt::math::V3 boundsMin {};
+    adt::u32 firstI {};
+    adt::math::V3 boundsMax {};
+    adt::u32 nItems {};
+};
+static_assert(sizeof(BvhNode) == 32);
+
+/* Leaves never get split below this, past it splitting is forced even if SAH says otherwise. */
+constexpr int BVH_MIN_LEAF_SIZE = 2;
+constexpr int BVH_MAX_LEAF_SIZE = 8;
+
+/* Past half of it nodes get split in the middle of their items, so traversal stacks of this size never overflow. */
+constexpr int BVH_MAX_DEPTH = 64;
+
+/* Binned SAH over the bounds of spItems, writes the nodes and the order of the items their leaves refer to. */
+void buildBvh(
+    adt::IAllocator* pAlloc, adt::Vec<BvhNode>* pVNodes, adt::Vec<adt::u32>* pVItemIs,
+    const adt::Span<const BvhNode> spItems /* bounds only */
+);
+
+/* Möller–Trumbore layout. */
+struct BlasTriangle
+{
+    adt::math::V3 v0 {};
+    adt::math::V3 e1 {}; /* v1 - v0 */
+    adt::math::V3 e2 {}; /* v2 - v0 */
+};
+
+/* Bottom level of one glTF primitive in object space (node.finalTransform excluded). */
+struct Blas
+{
+    adt::Vec<BvhNode> vNodes {};
+    adt::Vec<BlasTriangle> vTriangles {}; /* in leaf order */
+    adt::Vec<adt::math::IV4> vIndices {}; /* vertex indices per vTriangles entry, w is the index of the triangle in the primitive */
+    adt::Vec<adt::math::V3> vPositions {}; /* what vTriangles was made of, skinned meshes overwrite it before refit() */
+    adt::View<const adt::math::V2> vwUVs {}; /* empty without TEXCOORD_0 */
+    adt::View<const adt::math::V3> vwNormals {}; /* empty without NORMAL, shading falls back to the geometric normal */
+    const Image* pTexture {};
+
+    /* */
+
+    /* xyz are indices into vPositions, w is the index of the triangle in the primitive. */
+    void build(adt::IAllocator* pAlloc, const adt::Span<const adt::math::IV4> spTriangles);
+
+    /* Keeps the topology and only redoes the triangles and bounds from vPositions, for animated vertices. */
+    void refit();
+
+    void destroy(adt::IAllocator* pAlloc) noexcept;
+};
+
+/* Blas placed in world space, one per drawn glTF primitive. */
+struct Instance
+{
+    const Blas* pBlas {};
+    adt::math::M4 trm {};
+    adt::math::M4 trmInv {};
+    adt::i32 entityI {};
+    bool bOccluder {}; /* light models don't cast shadows on the scene */
+    bool bUnlit {};
+};
+
+/* Top level over the instances of a frame. */
+struct Scene
+{
+    adt::Vec<Instance> vInstances {};
+    adt::Vec<BvhNode> vNodes {};
+    adt::Vec<adt::u32> vInstanceIs {}; /* what the leaves refer to */
+
+    /* */
+
+    /* Rebuilds the top level from vInstances, cheap enough to do every frame. */
+    void build(adt::IAllocator* pAlloc);
+
+    void destroy(adt::IAllocator* pAlloc) noexcept;
+};
+
+/* Single ray queries for picking and visibility, dir doesn't have to be normalized (t is in units of it). */
+struct Ray
+{
+    adt::math::V3 origin {};
+    adt::math::V3 dir {};
+    adt::f32 tMax {};
+};
+
+struct Hit
+{
+    adt::f32 t {};
+    adt::f32 u {};
+    adt::f32 v {};
+    adt::i32 instanceI = -1;
+    adt::i32 triangleI = -1; /* into Blas::vTriangles */
+
+    /* */
+
+    explicit operator bool() const { return instanceI >= 0; }
+};
+
+/* Both go through the packet kernels with one active lane, kernels() must be set (Renderer::init()). */
+Hit intersect(const Scene& scene, const Ray& ray);
+bool occluded(const Scene& scene, const Ray& ray);
+
+} /* namespace render::rt */
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bvh.hh"
+
+namespace render::rt
+{
+
+/* Widest packet of any kernel build (AVX-512). */
+constexpr int MAX_PACKET_SIZE = 16;
+
+/* Kernels::laneWidth rays in SoA layout, lanes with tMax <= 0 are inactive. */
+struct RayPacket
+{
+    alignas(64) adt::f32 aOriginX[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aOriginY[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aOriginZ[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aDirX[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aDirY[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aDirZ[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aTMax[MAX_PACKET_SIZE] {};
+};
+
+/* Closest hits of a RayPacket, aInstanceIs is -1 for lanes that hit nothing.
+ * u and v are the barycentrics of the second and third vertex of the triangle. */
+struct PacketHits
+{
+    alignas(64) adt::f32 aT[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aU[MAX_PACKET_SIZE] {};
+    alignas(64) adt::f32 aV[MAX_PACKET_SIZE] {};
+    alignas(64) adt::i32 aInstanceIs[MAX_PACKET_SIZE] {};
+    alignas(64) adt::i32 aTriangleIs[MAX_PACKET_SIZE] {}; /* into Blas::vTriangles */
+};
+
+/* Packet traversal built once per cpu::ISA level (see kernels.inc), the renderer picks a table in init(). */
+struct Kernels
+{
+    int laneWidth {};
+
+    /* Closest hit in (0, tMax) of every active lane. */
+    void (*pfnIntersect)(const Scene& scene, const RayPacket& rays, PacketHits* pHits);
+
+    /* Writes -1 into paOccluded for lanes that hit any Instance::bOccluder triangle in (0, tMax), 0 otherwise. */
+    void (*pfnOccluded)(const Scene& scene, const RayPacket& rays, adt::i32* paOccluded);
+};
+
+extern const Kernels g_kernelsSSE4_2;
+extern const Kernels g_kernelsAVX2;
+extern const Kernels g_kernelsAVX512;
+
+/* Table for the detected cpu::ISA level, set in Renderer::init(). */
+extern const Kernels* g_pKernels;
+inline const Kernels& kernels() { return *g_pKernels; }
+
+} /* namespace render::rt */
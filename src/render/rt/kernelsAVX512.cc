@@ -0,0 +1,25 @@
+/* Built with -mavx512f -mavx512bw -mavx2 -mfma, ADT_AVX2 and ADT_AVX512 (see CMakeLists.txt). */
+
+#include "kernels.hh"
+
+#include "adt/simd.hh"
+
+#include <limits>
+
+using namespace adt;
+
+namespace render::rt::avx512
+{
+
+constexpr int LANE_WIDTH = 16;
+
+#include "kernels.inc"
+
+} /* namespace render::rt::avx512 */
+
+namespace render::rt
+{
+
+const Kernels g_kernelsAVX512 = avx512::KERNELS;
+
+} /* namespace render::rt */
@@ -0,0 +1,25 @@
+/* Built with the baseline flags. */
+
+#include "kernels.hh"
+
+#include "adt/simd.hh"
+
+#include <limits>
+
+using namespace adt;
+
+namespace render::rt::sse4_2
+{
+
+constexpr int LANE_WIDTH = 4;
+
+#include "kernels.inc"
+
+} /* namespace render::rt::sse4_2 */
+
+namespace render::rt
+{
+
+const Kernels g_kernelsSSE4_2 = sse4_2::KERNELS;
+
+} /* namespace render::rt */
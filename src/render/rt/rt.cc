@@ -0,0 +1,736 @@
+#include "rt.hh"
+
+#include "Model.hh"
+#include "app.hh"
+#include "asset.hh"
+#include "common.hh"
+#include "control.hh"
+#include "cpu/cpu.hh"
+#include "frame.hh"
+#include "game/game.hh"
+#include "kernels.hh"
+#include "render/sw/swui.hh"
+
+#include "adt/Map.hh"
+#include "adt/StdAllocator.hh"
+#include "adt/atomic.hh"
+#include "adt/file.hh"
+#include "adt/logs.hh"
+
+using namespace adt;
+
+namespace render::rt
+{
+
+const Kernels* g_pKernels = &g_kernelsSSE4_2;
+
+/* Distance of the camera far plane, same as the other renderers. */
+constexpr f32 CAMERA_FAR = 1000.0f;
+
+/* Shadow rays start this far off the surface (world units) so they don't hit the triangle they leave from. */
+constexpr f32 SHADOW_RAY_OFFSET = 1e-3f;
+
+/* Bottom level of one glTF primitive, shared by every entity of the model (they all have the same pose). */
+struct MeshBlas
+{
+    Blas blas {};
+    const Model* pModel {};
+    const gltf::Primitive* pPrimitive {};
+    const Model::Skin* pSkin {}; /* null if not skinned */
+    Vec<math::IV4> vJoints {};
+    Vec<math::V4> vWeights {};
+    bool bBuilt {};
+    u64 updatedFrameI {};
+};
+
+static u64 s_frameI = 0;
+
+static Scene s_scene {};
+
+/* keyed by meshBlasKey(), s_vMeshBlases owns them */
+static Map<u64, MeshBlas*> s_mapMeshBlases {};
+static Vec<MeshBlas*> s_vMeshBlases {};
+
+static u64
+meshBlasKey(const i16 modelI, const isize nodeI, const isize primitiveI)
+{
+    return (static_cast<u64>(static_cast<u16>(modelI)) << 48) | (static_cast<u64>(nodeI) << 24) | static_cast<u64>(primitiveI);
+}
+
+const Scene&
+scene()
+{
+    return s_scene;
+}
+
+static const Image*
+defaultTexture()
+{
+    static const Image s_img {
+        .m_uData {.pRGBA = const_cast<ImagePixelRGBA*>(common::g_spDefaultTexture.data())},
+        .m_width = static_cast<i16>(common::g_spDefaultTexture.width()),
+        .m_height = static_cast<i16>(common::g_spDefaultTexture.height()),
+        .m_eType = Image::TYPE::RGBA,
+    };
+
+    return &s_img;
+}
+
+static const Image*
+primitiveTexture(Arena* pArena, const Model& model, const gltf::Primitive& primitive)
+{
+    const auto& gltfModel = model.gltfModel();
+
+    if (primitive.materialI < 0) return defaultTexture();
+
+    const auto& mat = gltfModel.m_vMaterials[primitive.materialI];
+    if (mat.pbrMetallicRoughness.baseColorTexture.index < 0) return defaultTexture();
+
+    const auto& tex = gltfModel.m_vTextures[mat.pbrMetallicRoughness.baseColorTexture.index];
+    const auto& img = gltfModel.m_vImages[tex.sourceI];
+
+    /* NOTE: must be one of asset::g_poolObjects */
+    const auto* pObj = reinterpret_cast<const asset::Object*>(&gltfModel);
+
+    const String sPath = file::replacePathEnding(pArena, pObj->m_sMappedWith, img.sUri);
+    const Image* pImg = asset::searchImage(sPath);
+    if (!pImg) return defaultTexture();
+
+    return pImg;
+}
+
+/* JOINTS_0 is u8 or u16, WEIGHTS_0 is f32 or normalized u8 / u16, same as the sw skinning. */
+static bool
+widenSkinAttributes(MeshBlas* pMesh, const gltf::Model& gltfModel)
+{
+    const gltf::Primitive& primitive = *pMesh->pPrimitive;
+    if (primitive.attributes.JOINTS_0 < 0 || primitive.attributes.WEIGHTS_0 < 0) return false;
+
+    const isize size = pMesh->blas.vPositions.size();
+    IAllocator* pAlloc = StdAllocator::inst();
+
+    auto clJoints = [&]<typename T>(const View<const T> vwJoints)
+    {
+        pMesh->vJoints.setSize(pAlloc, size);
+        for (isize i = 0; i < size; ++i)
+        {
+            for (int influenceI = 0; influenceI < 4; ++influenceI)
+                pMesh->vJoints[i].e[influenceI] = static_cast<int>(vwJoints[i].e[influenceI]);
+        }
+    };
+
+    auto clWeights = [&]<typename T>(const View<const T> vwWeights, const f32 scale)
+    {
+        pMesh->vWeights.setSize(pAlloc, size);
+        for (isize i = 0; i < size; ++i)
+        {
+            for (int influenceI = 0; influenceI < 4; ++influenceI)
+                pMesh->vWeights[i].e[influenceI] = static_cast<f32>(vwWeights[i].e[influenceI]) * scale;
+        }
+    };
+
+    switch (gltfModel.m_vAccessors[primitive.attributes.JOINTS_0].eComponentType)
+    {
+        default: return false;
+
+        case gltf::COMPONENT_TYPE::UNSIGNED_BYTE:
+        clJoints(gltfModel.accessorView<const math::IV4u8>(primitive.attributes.JOINTS_0));
+        break;
+
+        case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
+        clJoints(gltfModel.accessorView<const math::IV4u16>(primitive.attributes.JOINTS_0));
+        break;
+    }
+
+    switch (gltfModel.m_vAccessors[primitive.attributes.WEIGHTS_0].eComponentType)
+    {
+        default:
+        pMesh->vJoints.destroy(pAlloc);
+        return false;
+
+        case gltf::COMPONENT_TYPE::FLOAT:
+        clWeights(gltfModel.accessorView<const math::V4>(primitive.attributes.WEIGHTS_0), 1.0f);
+        break;
+
+        case gltf::COMPONENT_TYPE::UNSIGNED_BYTE:
+        clWeights(gltfModel.accessorView<const math::IV4u8>(primitive.attributes.WEIGHTS_0), 1.0f / 255.0f);
+        break;
+
+        case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
+        clWeights(gltfModel.accessorView<const math::IV4u16>(primitive.attributes.WEIGHTS_0), 1.0f / 65535.0f);
+        break;
+    }
+
+    return true;
+}
+
+/* Looks up the bottom level of the primitive, makes an unbuilt one the first time. */
+static MeshBlas*
+meshBlas(Arena* pArena, const i16 modelI, const Model& model, const gltf::Node& gltfNode, const gltf::Primitive& primitive)
+{
+    const auto& gltfModel = model.gltfModel();
+    const isize nodeI = gltfModel.m_vNodes.idx(&gltfNode);
+    const isize primitiveI = gltfModel.m_vMeshes[gltfNode.meshI].vPrimitives.idx(&primitive);
+    const u64 key = meshBlasKey(modelI, nodeI, primitiveI);
+
+    if (!s_mapMeshBlases.empty())
+    {
+        auto res = s_mapMeshBlases.search(key);
+        if (res) return res.value();
+    }
+
+    IAllocator* pAlloc = StdAllocator::inst();
+    MeshBlas* pMesh = pAlloc->alloc<MeshBlas>();
+    pMesh->pModel = &model;
+    pMesh->pPrimitive = &primitive;
+
+    Blas& blas = pMesh->blas;
+    const View<const math::V3> vwPos = gltfModel.accessorView<const math::V3>(primitive.attributes.POSITION);
+    blas.vPositions.setSize(pAlloc, vwPos.size());
+    for (isize i = 0; i < vwPos.size(); ++i)
+        blas.vPositions[i] = vwPos[i];
+
+    if (primitive.attributes.TEXCOORD_0 > -1)
+        blas.vwUVs = gltfModel.accessorView<const math::V2>(primitive.attributes.TEXCOORD_0);
+
+    blas.pTexture = primitiveTexture(pArena, model, primitive);
+
+    /* joint matrices already undo the node's own transform, same as in the gl skinning shader */
+    if (gltfNode.skinI > -1)
+    {
+        pMesh->pSkin = &model.m_vSkins[gltfNode.skinI];
+        if (!widenSkinAttributes(pMesh, gltfModel)) pMesh->pSkin = nullptr;
+    }
+
+    /* bind pose normals don't hold for skinned positions, those get the geometric one */
+    if (!pMesh->pSkin && primitive.attributes.NORMAL > -1)
+        blas.vwNormals = gltfModel.accessorView<const math::V3>(primitive.attributes.NORMAL);
+
+    s_vMeshBlases.push(pAlloc, pMesh);
+    s_mapMeshBlases.insert(pAlloc, key, pMesh);
+
+    return pMesh;
+}
+
+static void
+buildMeshBlas(MeshBlas* pMesh)
+{
+    IAllocator* pAlloc = StdAllocator::inst();
+    const auto& gltfModel = pMesh->pModel->gltfModel();
+    const gltf::Primitive& primitive = *pMesh->pPrimitive;
+    const isize nVertices = pMesh->blas.vPositions.size();
+
+    Vec<math::IV4> vTriangles {};
+    ADT_DEFER( vTriangles.destroy(pAlloc) );
+
+    auto clIndexed = [&]<typename T>(const View<const T> vwIndices)
+    {
+        for (isize i = 0; i + 2 < vwIndices.size(); i += 3)
+        {
+            const i32 i0 = static_cast<i32>(vwIndices[i + 0]);
+            const i32 i1 = static_cast<i32>(vwIndices[i + 1]);
+            const i32 i2 = static_cast<i32>(vwIndices[i + 2]);
+            if (i0 < nVertices && i1 < nVertices && i2 < nVertices)
+                vTriangles.push(pAlloc, {i0, i1, i2, static_cast<i32>(i / 3)});
+        }
+    };
+
+    if (primitive.indicesI < 0)
+    {
+        for (isize i = 0; i + 2 < nVertices; i += 3)
+            vTriangles.push(pAlloc, {static_cast<i32>(i), static_cast<i32>(i + 1), static_cast<i32>(i + 2), static_cast<i32>(i / 3)});
+    }
+    else
+    {
+        const gltf::Accessor& accIndices = gltfModel.m_vAccessors[primitive.indicesI];
+        switch (accIndices.eComponentType)
+        {
+            default:
+            LOG_BAD("unsupported index type: {}\n", static_cast<int>(accIndices.eComponentType));
+            break;
+
+            case gltf::COMPONENT_TYPE::UNSIGNED_BYTE:
+            clIndexed(gltfModel.accessorView<const u8>(primitive.indicesI));
+            break;
+
+            case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
+            clIndexed(gltfModel.accessorView<const u16>(primitive.indicesI));
+            break;
+
+            case gltf::COMPONENT_TYPE::UNSIGNED_INT:
+            clIndexed(gltfModel.accessorView<const u32>(primitive.indicesI));
+            break;
+        }
+    }
+
+    pMesh->blas.build(pAlloc, {vTriangles.data(), vTriangles.size()});
+}
+
+/* Skinned meshes get the current pose and a refit, the rest only gets built once. */
+static THREAD_STATUS
+updateMeshBlas(void* pArg)
+{
+    auto* pMesh = static_cast<MeshBlas*>(pArg);
+    Blas& blas = pMesh->blas;
+
+    if (pMesh->pSkin && !pMesh->pSkin->vJointMatrices.empty())
+    {
+        const auto& gltfModel = pMesh->pModel->gltfModel();
+        const View<const math::V3> vwPos = gltfModel.accessorView<const math::V3>(pMesh->pPrimitive->attributes.POSITION);
+        const Vec<math::M4>& vJointMatrices = pMesh->pSkin->vJointMatrices;
+        const int lastJointI = static_cast<int>(vJointMatrices.size()) - 1;
+
+        for (isize i = 0; i < blas.vPositions.size(); ++i)
+        {
+            const math::V4 pos = math::V4From(vwPos[i], 1.0f);
+            math::V4 res {};
+            for (int influenceI = 0; influenceI < 4; ++influenceI)
+            {
+                const f32 weight = pMesh->vWeights[i].e[influenceI];
+                const int jointI = utils::min(pMesh->vJoints[i].e[influenceI], lastJointI);
+                res += (vJointMatrices[jointI] * pos) * weight;
+            }
+
+            blas.vPositions[i] = res.xyz;
+        }
+
+        if (pMesh->bBuilt) blas.refit();
+    }
+
+    if (!pMesh->bBuilt)
+    {
+        buildMeshBlas(pMesh);
+        pMesh->bBuilt = true;
+    }
+
+    return THREAD_STATUS(0);
+}
+
+/* Adds an instance per triangle primitive under the node, pVUpdates gets the bottom levels to update this frame. */
+static void
+addNodeInstances(
+    Arena* pArena, Vec<MeshBlas*>* pVUpdates, const i16 modelI, const Model& model, const Model::Node& node,
+    const math::M4& trm, const int entityI, const bool bLight
+)
+{
+    using namespace adt::math;
+
+    IAllocator* pAlloc = StdAllocator::inst();
+    const gltf::Node& gltfNode = model.gltfNode(node);
+    const auto& gltfModel = model.gltfModel();
+
+    for (const int& child : gltfNode.vChildren)
+        addNodeInstances(pArena, pVUpdates, modelI, model, model.m_vNodes[child], trm, entityI, bLight);
+
+    if (gltfNode.meshI < 0) return;
+
+    const M4 finalTrm = trm * node.finalTransform;
+    const auto& gltfMesh = gltfModel.m_vMeshes[gltfNode.meshI];
+
+    for (const auto& primitive : gltfMesh.vPrimitives)
+    {
+        if (primitive.eMode != gltf::Primitive::TYPE::TRIANGLES || primitive.attributes.POSITION < 0) continue;
+
+        MeshBlas* pMesh = meshBlas(pArena, modelI, model, gltfNode, primitive);
+        if (pMesh->updatedFrameI != s_frameI && (!pMesh->bBuilt || pMesh->pSkin))
+        {
+            pMesh->updatedFrameI = s_frameI;
+            pVUpdates->push(pAlloc, pMesh);
+        }
+
+        s_scene.vInstances.push(pAlloc, {
+            .pBlas = &pMesh->blas,
+            .trm = finalTrm,
+            .trmInv = M4Inv(finalTrm),
+            .entityI = entityI,
+            .bOccluder = !bLight,
+            .bUnlit = bLight,
+        });
+    }
+}
+
+/* Instances of every drawn entity, bottom levels get built and refitted on the thread pool, then the top level on top. */
+static void
+buildScene(Arena* pArena)
+{
+    using namespace adt::math;
+
+    IAllocator* pAlloc = StdAllocator::inst();
+    s_scene.vInstances.setSize(pAlloc, 0);
+
+    Vec<MeshBlas*> vUpdates {};
+    ADT_DEFER( vUpdates.destroy(pAlloc) );
+
+    auto& entities = game::g_vEntities;
+    if (entities.size() > 0)
+    {
+        game::Entity::Bind bind0 = entities[0];
+
+        for (int entityI = 0; entityI < entities.size(); ++entityI)
+        {
+            if ((&bind0.bNoDraw)[entityI]) continue;
+
+            auto& obj = asset::g_poolObjects[ {(&bind0.assetI)[entityI]} ];
+            if (obj.m_eType != asset::Object::TYPE::MODEL) continue;
+
+            const i16 modelI = (&bind0.modelI)[entityI];
+            const Model& model = Model::fromI(modelI);
+            const gltf::Model& gltfModel = model.gltfModel();
+            const gltf::Scene& gltfScene = gltfModel.m_vScenes[gltfModel.m_defaultSceneI];
+            const M4 trm = transformation((&bind0.pos)[entityI], (&bind0.rot)[entityI], (&bind0.scale)[entityI]);
+            const bool bLight = (&bind0.eType)[entityI] == game::ENTITY_TYPE::LIGHT;
+
+            for (const int& nodeI : gltfScene.vNodes)
+                addNodeInstances(pArena, &vUpdates, modelI, model, model.m_vNodes[nodeI], trm, entityI, bLight);
+        }
+    }
+
+    for (MeshBlas* pMesh : vUpdates)
+        app::g_threadPool.addRetry(updateMeshBlas, pMesh);
+
+    app::g_threadPool.wait();
+
+    /* primitives without a single triangle can't be placed */
+    isize nInstances = 0;
+    for (const Instance& inst : s_scene.vInstances)
+    {
+        if (!inst.pBlas->vNodes.empty())
+            s_scene.vInstances[nInstances++] = inst;
+    }
+    s_scene.vInstances.setSize(pAlloc, nInstances);
+
+    s_scene.build(pAlloc);
+}
+
+struct TraceTilesArg
+{
+    const Scene* pScene {};
+    Span2D<ImagePixelRGBA> sp {};
+    math::V3 origin {};
+    math::V3 right {}; /* scaled to the half extent of the image plane at distance 1 */
+    math::V3 up {};
+    math::V3 front {};
+    bool bLight {};
+    math::V3 lightPos {};
+    math::V3 lightColor {};
+    math::V3 ambient {};
+    ImagePixelRGBA clearColor {};
+    int nTilesX {};
+    int nTilesY {};
+    atomic::Int atomNextTileI {};
+};
+
+/* Bilinear with repeat wrap, same texel mapping as the sw sampler. */
+static math::V4
+sampleTexture(const Image& img, const math::V2 uv)
+{
+    const Span2D<const ImagePixelRGBA> sp = img.mipRGBA(0);
+    const int width = static_cast<int>(sp.width());
+    const int height = static_cast<int>(sp.height());
+
+    const f32 x = uv.x*static_cast<f32>(width) - 0.5f;
+    const f32 y = uv.y*static_cast<f32>(height) - 0.5f;
+    const f32 floorX = std::floor(x);
+    const f32 floorY = std::floor(y);
+    const f32 s = x - floorX;
+    const f32 k = y - floorY;
+
+    auto clTexel = [&](const f32 texelX, const f32 texelY) -> math::V4
+    {
+        const int wrappedX = static_cast<int>(texelX - std::floor(texelX / static_cast<f32>(width)) * static_cast<f32>(width));
+        const int wrappedY = static_cast<int>(texelY - std::floor(texelY / static_cast<f32>(height)) * static_cast<f32>(height));
+        const int clampedX = utils::clamp(wrappedX, 0, width - 1);
+        const int clampedY = utils::clamp(wrappedY, 0, height - 1);
+
+        const int offset = img.m_eLayout == Image::LAYOUT::TILED_4X4 ?
+            Image::tiledOffset(clampedX, clampedY, static_cast<int>(sp.stride())) :
+            clampedY*static_cast<int>(sp.stride()) + clampedX;
+
+        const ImagePixelRGBA texel = sp.data()[offset];
+        return {static_cast<f32>(texel.r), static_cast<f32>(texel.g), static_cast<f32>(texel.b), static_cast<f32>(texel.a)};
+    };
+
+    const math::V4 top = math::lerp(clTexel(floorX, floorY), clTexel(floorX + 1.0f, floorY), s);
+    const math::V4 bottom = math::lerp(clTexel(floorX, floorY + 1.0f), clTexel(floorX + 1.0f, floorY + 1.0f), s);
+
+    return math::lerp(top, bottom, k) * (1.0f / 255.0f);
+}
+
+/* Surface of one closest hit lane. */
+struct SurfaceHit
+{
+    math::V3 pos {};
+    math::V3 normal {}; /* world space, facing the ray */
+    math::V4 color {};
+    bool bUnlit {};
+};
+
+static SurfaceHit
+surfaceHit(const Scene& scene, const PacketHits& hits, const int laneI, const math::V3 rayOrigin, const math::V3 rayDir)
+{
+    using namespace adt::math;
+
+    const Instance& inst = scene.vInstances[hits.aInstanceIs[laneI]];
+    const Blas& blas = *inst.pBlas;
+    const IV4& indices = blas.vIndices[hits.aTriangleIs[laneI]];
+    const f32 u = hits.aU[laneI];
+    const f32 v = hits.aV[laneI];
+    const f32 w = 1.0f - u - v;
+
+    V3 objectNormal;
+    if (!blas.vwNormals.empty())
+    {
+        objectNormal = blas.vwNormals[indices.x]*w + blas.vwNormals[indices.y]*u + blas.vwNormals[indices.z]*v;
+    }
+    else
+    {
+        const BlasTriangle& tri = blas.vTriangles[hits.aTriangleIs[laneI]];
+        objectNormal = V3Cross(tri.e1, tri.e2);
+    }
+
+    /* inverse transpose, rows of the inverse are the columns of the normal matrix */
+    const M4& m = inst.trmInv;
+    V3 normal = V3Norm({
+        m.e[0][0]*objectNormal.x + m.e[0][1]*objectNormal.y + m.e[0][2]*objectNormal.z,
+        m.e[1][0]*objectNormal.x + m.e[1][1]*objectNormal.y + m.e[1][2]*objectNormal.z,
+        m.e[2][0]*objectNormal.x + m.e[2][1]*objectNormal.y + m.e[2][2]*objectNormal.z,
+    });
+    if (V3Dot(normal, rayDir) > 0.0f) normal = -normal;
+
+    V2 uv {};
+    if (!blas.vwUVs.empty())
+        uv = blas.vwUVs[indices.x]*w + blas.vwUVs[indices.y]*u + blas.vwUVs[indices.z]*v;
+
+    return {
+        .pos = rayOrigin + rayDir*hits.aT[laneI],
+        .normal = normal,
+        .color = sampleTexture(blas.pTexture ? *blas.pTexture : *defaultTexture(), uv),
+        .bUnlit = inst.bUnlit,
+    };
+}
+
+/* Each tile is owned by exactly one thread at a time. A row group of laneWidth pixels is one packet. */
+static THREAD_STATUS
+traceTiles(void* pArg)
+{
+    using namespace adt::math;
+
+    auto& arg = *static_cast<TraceTilesArg*>(pArg);
+    const Scene& scene = *arg.pScene;
+    const int laneWidth = kernels().laneWidth;
+    const int width = static_cast<int>(arg.sp.width());
+    const int height = static_cast<int>(arg.sp.height());
+    const int nTiles = arg.nTilesX * arg.nTilesY;
+
+    RayPacket rays {};
+    PacketHits hits {};
+    RayPacket shadowRays {};
+    alignas(64) i32 aOccluded[MAX_PACKET_SIZE] {};
+    SurfaceHit aSurfaces[MAX_PACKET_SIZE] {};
+
+    int tileI;
+    while ((tileI = arg.atomNextTileI.fetchAdd(1, atomic::ORDER::RELAXED)) < nTiles)
+    {
+        const int minX = (tileI % arg.nTilesX) * TILE_SIZE;
+        const int minY = (tileI / arg.nTilesX) * TILE_SIZE;
+        const int endX = utils::min(minX + TILE_SIZE, width);
+        const int endY = utils::min(minY + TILE_SIZE, height);
+
+        for (int y = minY; y < endY; ++y)
+        {
+            /* bottom row first */
+            const f32 ndcY = 2.0f * (static_cast<f32>(y) + 0.5f) / static_cast<f32>(height) - 1.0f;
+
+            for (int x = minX; x < endX; x += laneWidth)
+            {
+                const int nLanes = utils::min(laneWidth, endX - x);
+
+                for (int laneI = 0; laneI < laneWidth; ++laneI)
+                {
+                    const f32 ndcX = 2.0f * (static_cast<f32>(x + laneI) + 0.5f) / static_cast<f32>(width) - 1.0f;
+                    const V3 dir = arg.front + arg.right*ndcX + arg.up*ndcY;
+
+                    rays.aOriginX[laneI] = arg.origin.x;
+                    rays.aOriginY[laneI] = arg.origin.y;
+                    rays.aOriginZ[laneI] = arg.origin.z;
+                    rays.aDirX[laneI] = dir.x;
+                    rays.aDirY[laneI] = dir.y;
+                    rays.aDirZ[laneI] = dir.z;
+                    rays.aTMax[laneI] = laneI < nLanes ? CAMERA_FAR : 0.0f;
+                }
+
+                kernels().pfnIntersect(scene, rays, &hits);
+
+                /* shadow rays toward the light, unnormalized so that t = 1 is the light */
+                bool bAnyShadowRay = false;
+                for (int laneI = 0; laneI < laneWidth; ++laneI)
+                {
+                    shadowRays.aTMax[laneI] = 0.0f;
+                    if (laneI >= nLanes || hits.aInstanceIs[laneI] < 0) continue;
+
+                    const V3 rayDir {rays.aDirX[laneI], rays.aDirY[laneI], rays.aDirZ[laneI]};
+                    aSurfaces[laneI] = surfaceHit(scene, hits, laneI, arg.origin, rayDir);
+                    const SurfaceHit& surface = aSurfaces[laneI];
+                    if (!arg.bLight || surface.bUnlit) continue;
+
+                    const V3 origin = surface.pos + surface.normal*SHADOW_RAY_OFFSET;
+                    const V3 toLight = arg.lightPos - origin;
+                    if (V3Dot(toLight, surface.normal) <= 0.0f) continue;
+
+                    shadowRays.aOriginX[laneI] = origin.x;
+                    shadowRays.aOriginY[laneI] = origin.y;
+                    shadowRays.aOriginZ[laneI] = origin.z;
+                    shadowRays.aDirX[laneI] = toLight.x;
+                    shadowRays.aDirY[laneI] = toLight.y;
+                    shadowRays.aDirZ[laneI] = toLight.z;
+                    shadowRays.aTMax[laneI] = 1.0f;
+                    bAnyShadowRay = true;
+                }
+
+                if (bAnyShadowRay) kernels().pfnOccluded(scene, shadowRays, aOccluded);
+
+                for (int laneI = 0; laneI < nLanes; ++laneI)
+                {
+                    ImagePixelRGBA& pixel = arg.sp(x + laneI, y);
+
+                    if (hits.aInstanceIs[laneI] < 0)
+                    {
+                        pixel = arg.clearColor;
+                        continue;
+                    }
+
+                    const SurfaceHit& surface = aSurfaces[laneI];
+
+                    /* same terms as the gl gouraud shader, per pixel */
+                    V3 light {1.0f, 1.0f, 1.0f};
+                    if (!surface.bUnlit)
+                    {
+                        light = arg.ambient;
+                        if (shadowRays.aTMax[laneI] > 0.0f && !aOccluded[laneI])
+                        {
+                            const V3 toLight = V3Norm(arg.lightPos - surface.pos);
+                            light += arg.lightColor * utils::max(V3Dot(surface.normal, toLight), 0.0f);
+                        }
+                    }
+
+                    pixel.r = static_cast<u8>(utils::min(surface.color.r * light.x, 1.0f) * 255.0f);
+                    pixel.g = static_cast<u8>(utils::min(surface.color.g * light.y, 1.0f) * 255.0f);
+                    pixel.b = static_cast<u8>(utils::min(surface.color.b * light.z, 1.0f) * 255.0f);
+                    pixel.a = 255;
+                }
+            }
+        }
+    }
+
+    return THREAD_STATUS(0);
+}
+
+void
+Renderer::init()
+{
+    switch (cpu::g_eISA)
+    {
+        case cpu::ISA::SSE4_2: g_pKernels = &g_kernelsSSE4_2; break;
+        case cpu::ISA::AVX2: g_pKernels = &g_kernelsAVX2; break;
+        case cpu::ISA::AVX512: g_pKernels = &g_kernelsAVX512; break;
+    }
+
+    LOG_GOOD("ray tracing kernels: {}, {} rays per packet\n", cpu::ISAName(cpu::g_eISA), kernels().laneWidth);
+
+    sw::ui::init();
+}
+
+void
+Renderer::draw(Arena* pArena)
+{
+    using namespace adt::math;
+
+    auto& win = app::windowInst();
+
+    if (!control::g_bPauseSimulation)
+    {
+        for (auto& model : Model::g_poolModels)
+        {
+            app::g_threadPool.addRetry(+[](void* p) -> THREAD_STATUS
+                {
+                    auto* pModel = static_cast<Model*>(p);
+                    pModel->updateAnimation(pModel->m_time + frame::g_frameTime);
+                    return THREAD_STATUS(0);
+                }, &model
+            );
+        }
+
+        app::g_threadPool.wait();
+    }
+
+    ++s_frameI;
+    buildScene(pArena);
+
+    const auto& camera = control::g_camera;
+    const f32 aspectRatio = static_cast<f32>(win.m_winWidth) / static_cast<f32>(win.m_winHeight);
+    const f32 tanHalfFov = std::tan(toRad(camera.m_fov) * 0.5f);
+
+    /* rows of the view matrix are the camera axes */
+    const M4& view = camera.m_view;
+    const V3 right {view.e[0][0], view.e[1][0], view.e[2][0]};
+    const V3 up {view.e[0][1], view.e[1][1], view.e[2][1]};
+    const V3 front {view.e[0][2], view.e[1][2], view.e[2][2]};
+
+    const bool bLight = game::g_dirLight < game::g_vEntities.size();
+
+    /* always full size, the sw renderer may have left a scaled viewport behind */
+    win.presentRect(win.m_width, win.m_height);
+    Span2D<ImagePixelRGBA> spSurface = win.surfaceBuffer();
+
+    TraceTilesArg arg {
+        .pScene = &s_scene,
+        .sp = {spSurface.data(), win.m_width, win.m_height, spSurface.stride()},
+        .origin = camera.m_pos,
+        .right = right * (tanHalfFov * aspectRatio),
+        .up = up * tanHalfFov,
+        .front = front,
+        .bLight = bLight,
+        .lightPos = bLight ? game::g_vEntities[game::g_dirLight].pos : V3 {},
+        .lightColor = bLight ? game::g_vEntities[game::g_dirLight].color.xyz : V3 {},
+        .ambient = game::g_ambientLight,
+        .clearColor {.data = colors::V4ToRGBA({0.1f, 0.1f, 0.1f, 1.0f})},
+        .nTilesX = (win.m_width + TILE_SIZE - 1) / TILE_SIZE,
+        .nTilesY = (win.m_height + TILE_SIZE - 1) / TILE_SIZE,
+    };
+
+    const int nTiles = arg.nTilesX * arg.nTilesY;
+    const int nHelpers = utils::min(app::g_threadPool.nThreads(), nTiles - 1);
+    for (int i = 0; i < nHelpers; ++i)
+        app::g_threadPool.addRetry(traceTiles, &arg);
+
+    /* main thread takes tiles too */
+    traceTiles(&arg);
+    app::g_threadPool.wait();
+
+    if (control::g_bDrawUI)
+        sw::ui::draw(pArena, arg.sp);
+
+    /* the whole surface changes every frame */
+    win.damageRect(0, 0, win.m_width, win.m_height);
+}
+
+void
+Renderer::destroy()
+{
+    IAllocator* pAlloc = StdAllocator::inst();
+
+    for (MeshBlas* pMesh : s_vMeshBlases)
+    {
+        pMesh->blas.destroy(pAlloc);
+        pMesh->vJoints.destroy(pAlloc);
+        pMesh->vWeights.destroy(pAlloc);
+        pAlloc->dealloc(pMesh);
+    }
+
+    s_vMeshBlases.destroy(pAlloc);
+    s_mapMeshBlases.destroy(pAlloc);
+    s_scene.destroy(pAlloc);
+    sw::ui::destroy();
+}
+
+} /* namespace render::rt */
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../IRenderer.hh"
+#include "bvh.hh"
+
+namespace render::rt
+{
+
+/* Screen is split into TILE_SIZE x TILE_SIZE tiles, each one is a thread pool job. */
+constexpr int TILE_SIZE = 32;
+
+/* Ray traces the scene on the cpu: a SAH bvh per glTF primitive (refitted when skinned) under a top level over the entities,
+ * camera and shadow rays go in Kernels::laneWidth wide packets. Draws into the same window buffer as the sw renderer. */
+struct Renderer : public IRenderer
+{
+    virtual void init() override;
+    virtual void draw(adt::Arena* pArena) override;
+    virtual void destroy() override;
+};
+
+/* Instances and top level of the last drawn frame, for picking and visibility queries (see intersect() and occluded()). */
+const Scene& scene();
+
+} /* namespace render::rt */
@@ -11,7 +11,7 @@ formatToContext(Context ctx, FormatArgs, const render::sw::clip::AXIS e)
     ctx.fmt = "{}";
     ctx.fmtIdx = 0;
     
-    const String asMap[] {
+    constexpr StringView asMap[] {
         "NONE", "LEFT", "RIGHT", "TOP", "BOTTOM", "NEAR", "FAR", "W"
     };
 
@@ -23,8 +23,6 @@ formatToContext(Context ctx, FormatArgs, const render::sw::clip::AXIS e)
 namespace render::sw::clip
 {
 
-constexpr f32 VERY_SMALL_NUMBER = 0.0001f;
-
 static bool
 behindPlane(math::V4 v, AXIS eAxis)
 {
@@ -117,128 +115,43 @@ calcIntersection(Vertex start, Vertex end, AXIS eAxis)
 }
 
 void
-polygonToAxis(const Result* pInput, Result* pOutput, const AXIS eAxis)
+polygon(Polygon* pPolygon, const u16 planeMask)
 {
-    pOutput->nTriangles = 0;
+    auto& poly = *pPolygon;
 
-    for (int triangleIdx = 0; triangleIdx < pInput->nTriangles; ++triangleIdx)
+    for (u8 eAxis = AXIS::LEFT; eAxis <= AXIS::W; ++eAxis)
     {
-        const int aVertexIdx[3] {
-            3 * triangleIdx + 0,
-            3 * triangleIdx + 1,
-            3 * triangleIdx + 2,
-        };
-
-        const Vertex aVertices[3] {
-            pInput->aVertices[ aVertexIdx[0] ],
-            pInput->aVertices[ aVertexIdx[1] ],
-            pInput->aVertices[ aVertexIdx[2] ],
-        };
-
-        const bool abBehindPlane[3] {
-            behindPlane(aVertices[0].pos, eAxis),
-            behindPlane(aVertices[1].pos, eAxis),
-            behindPlane(aVertices[2].pos, eAxis),
-        };
-
-        isize nBehindPlane = abBehindPlane[0] + abBehindPlane[1] + abBehindPlane[2];
-
-        switch (nBehindPlane)
+        if (!(planeMask & (1 << (eAxis - 1)))) continue;
+
+        u8 aOut[MAX_POLYGON_VERTICES];
+        int nOut = 0;
+
+        for (int i = 0; i < poly.nIndices; ++i)
         {
-            case 0:
-            {
-                /* copy fully visible triangle */
-                int currTriangleIdx = pOutput->nTriangles++;
-                pOutput->aVertices[3*currTriangleIdx + 0] = aVertices[0];
-                pOutput->aVertices[3*currTriangleIdx + 1] = aVertices[1];
-                pOutput->aVertices[3*currTriangleIdx + 2] = aVertices[2];
-            }
-            break;
+            const u8 startI = poly.aIndices[i];
+            const u8 endI = poly.aIndices[i == poly.nIndices - 1 ? 0 : i + 1];
 
-            case 1:
-            {
-                /* cut in two pieces */
-                int currTriangleI = pOutput->nTriangles;
-                int currVertexI = 0;
-                bool bTriangleAdded = false;
-                pOutput->nTriangles += 2;
-
-                for (int edgeI = 0; edgeI < 3; ++edgeI)
-                {
-                    int startVertexI = edgeI;
-                    int endVertexI = (edgeI == 2) ? 0 : (edgeI + 1);
-
-                    Vertex startVertex = aVertices[startVertexI];
-                    Vertex endVertex = aVertices[endVertexI];
-
-                    bool bStartBehindPlane = abBehindPlane[startVertexI];
-                    bool bEndBehindPlane = abBehindPlane[endVertexI];
-
-                    if (!bStartBehindPlane)
-                        pOutput->aVertices[3*currTriangleI + currVertexI++] = startVertex;
-
-                    if (!bTriangleAdded && currVertexI == 3)
-                    {
-                        bTriangleAdded = true;
-                        ++currTriangleI;
-                        currVertexI = 0;
-                        pOutput->aVertices[3*currTriangleI + currVertexI++] = pOutput->aVertices[3*(currTriangleI - 1) + 0];
-                        pOutput->aVertices[3*currTriangleI + currVertexI++] = pOutput->aVertices[3*(currTriangleI - 1) + 2];
-                    }
-
-                    if (bStartBehindPlane != bEndBehindPlane)
-                        pOutput->aVertices[3*currTriangleI + currVertexI++] = calcIntersection(startVertex, endVertex, eAxis);
-
-                    if (!bTriangleAdded && currVertexI == 3)
-                    {
-                        bTriangleAdded = true;
-                        ++currTriangleI;
-                        currVertexI = 0;
-                        pOutput->aVertices[3*currTriangleI + currVertexI++] = pOutput->aVertices[3*(currTriangleI - 1) + 0];
-                        pOutput->aVertices[3*currTriangleI + currVertexI++] = pOutput->aVertices[3*(currTriangleI - 1) + 2];
-                    }
-                }
-            }
-            break;
+            const bool bStartBehindPlane = behindPlane(poly.aPool[startI].pos, AXIS(eAxis));
+            const bool bEndBehindPlane = behindPlane(poly.aPool[endI].pos, AXIS(eAxis));
 
-            case 2:
-            {
-                int currTriangleIdx = pOutput->nTriangles++;
-                int currVertexIdx = 0;
-
-                for (int edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
-                {
-                    int startVertexIdx = edgeIdx;
-                    int endVertexIdx = edgeIdx == 2 ? 0 : edgeIdx + 1;
-
-                    Vertex startVertex = aVertices[startVertexIdx];
-                    Vertex endVertex = aVertices[endVertexIdx];
-
-                    bool bStartBehindPlane = abBehindPlane[startVertexIdx];
-                    bool bEndBehindPlane = abBehindPlane[endVertexIdx];
-
-                    if (!bStartBehindPlane)
-                    {
-                        pOutput->aVertices[3*currTriangleIdx + currVertexIdx++] = startVertex;
-                    }
-
-                    if (bStartBehindPlane != bEndBehindPlane)
-                    {
-                        pOutput->aVertices[3*currTriangleIdx + currVertexIdx++] = calcIntersection(startVertex, endVertex, eAxis);
-                    }
-                }
-            }
-            break;
+            if (!bStartBehindPlane)
+                aOut[nOut++] = startI;
 
-            case 3:
+            if (bStartBehindPlane != bEndBehindPlane)
             {
-                /* don't add */
+                ADT_ASSERT(poly.nPool < MAX_POOL_VERTICES, "nPool: {}", poly.nPool);
+                poly.aPool[poly.nPool] = calcIntersection(poly.aPool[startI], poly.aPool[endI], AXIS(eAxis));
+                aOut[nOut++] = static_cast<u8>(poly.nPool++);
             }
-            break;
-
-            default:
-            ADT_ASSERT(false, "invalid code path");
         }
+
+        ADT_ASSERT(nOut <= MAX_POLYGON_VERTICES, "nOut: {}", nOut);
+
+        for (int i = 0; i < nOut; ++i)
+            poly.aIndices[i] = aOut[i];
+        poly.nIndices = nOut;
+
+        if (nOut < 3) return;
     }
 }
 
@@ -5,22 +5,69 @@
 namespace render::sw::clip
 {
 
-constexpr int MAX_NUM_VERTICES = 128;
+constexpr adt::f32 VERY_SMALL_NUMBER = 0.0001f;
+
+/* Each plane can add at most one vertex to a convex polygon, and at most two to the pool. */
+constexpr int MAX_POLYGON_VERTICES = 3 + 7;
+constexpr int MAX_POOL_VERTICES = 3 + 2*7;
 
 enum AXIS : adt::u8 {NONE, LEFT, RIGHT, TOP, BOTTOM, NEAR, FAR, W};
 
+/* Per vertex plane mask, bit (AXIS - 1) is set when the vertex is behind that plane.
+ * GUARD_* bits are the same test against the widened guard band planes. */
+enum OUTCODE : adt::u16
+{
+    OUT_LEFT = 1 << (LEFT - 1),
+    OUT_RIGHT = 1 << (RIGHT - 1),
+    OUT_TOP = 1 << (TOP - 1),
+    OUT_BOTTOM = 1 << (BOTTOM - 1),
+    OUT_NEAR = 1 << (NEAR - 1),
+    OUT_FAR = 1 << (FAR - 1),
+    OUT_W = 1 << (W - 1),
+
+    OUT_GUARD_LEFT = OUT_LEFT << 7,
+    OUT_GUARD_RIGHT = OUT_RIGHT << 7,
+    OUT_GUARD_TOP = OUT_TOP << 7,
+    OUT_GUARD_BOTTOM = OUT_BOTTOM << 7,
+
+    OUT_FRUSTUM = OUT_LEFT | OUT_RIGHT | OUT_TOP | OUT_BOTTOM | OUT_NEAR | OUT_FAR | OUT_W,
+};
+
 struct Vertex
 {
     adt::math::V4 pos {};
     adt::math::V2 uv {};
 };
 
-struct Result
+/* Convex polygon as indices into the vertex pool, first 3 pool vertices are the input triangle. */
+struct Polygon
 {
-    int nTriangles {};
-    Vertex aVertices[MAX_NUM_VERTICES] {};
+    Vertex aPool[MAX_POOL_VERTICES] {};
+    adt::u8 aIndices[MAX_POLYGON_VERTICES] {};
+    int nPool {};
+    int nIndices {};
+
+    /* */
+
+    Polygon() = default;
+    Polygon(const Vertex& v0, const Vertex& v1, const Vertex& v2)
+        : aPool {v0, v1, v2}, aIndices {0, 1, 2}, nPool(3), nIndices(3) {}
+
+    /* */
+
+    const Vertex& operator[](int i) const { return aPool[aIndices[i]]; }
 };
 
-void polygonToAxis(const Result* pInput, Result* pOutput, const AXIS eAxis);
+/* Planes that have to be clipped against, given OR of the triangle's outcodes.
+ * Triangles inside of the guard band don't get clipped to the viewport, raster scissors them. */
+inline adt::u16
+planesToClip(const adt::u16 orOutcodes)
+{
+    return ((orOutcodes >> 7) & (OUT_LEFT | OUT_RIGHT | OUT_TOP | OUT_BOTTOM)) |
+        (orOutcodes & (OUT_NEAR | OUT_FAR | OUT_W));
+}
+
+/* Clips against each plane set in the mask, nIndices < 3 means nothing is left. */
+void polygon(Polygon* pPolygon, const adt::u16 planeMask);
 
 } /* namespace render::sw::clip */
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "IWindow.hh"
+#include "clip.hh"
+#include "sw.hh"
+
+#include "adt/View.hh"
+
+namespace render::sw
+{
+
+enum class SAMPLER : adt::u8 { NEAREST, BILINEAR, TRILINEAR };
+
+/* TEST leaves depth and hi-z untouched, for primitives that must not occlude anything. */
+enum class DEPTH : adt::u8 { TEST_WRITE, TEST };
+
+enum class BLEND : adt::u8 { NONE, ALPHA };
+
+/* Varyings a kernel interpolates: SHADE does uv and texturing, VISIBILITY only writes the triangle index,
+ * DEPTH interpolates nothing but depth and leaves color alone (shadow maps, RasterTarget::sp may be empty). */
+enum class PASS : adt::u8 { SHADE, VISIBILITY, DEPTH };
+
+/* Pipeline state of a draw, each combination gets its own kernel instantiation. */
+struct RasterState
+{
+    SAMPLER eSampler {};
+    DEPTH eDepth {};
+    BLEND eBlend {};
+    PASS ePass {};
+    DEPTH_FORMAT eDepthFormat {};
+};
+
+struct RasterTarget
+{
+    adt::Span2D<ImagePixelRGBA> sp {};
+    adt::Span2D<adt::f32> spDepth {}; /* only the one matching RasterState::eDepthFormat is set */
+    adt::Span2D<adt::u16> spDepth16 {};
+    adt::Span2D<adt::u32> spDepthStencil {};
+    adt::Span2D<adt::f32> spHiZ {}; /* max depth in units of the depth format */
+    adt::Span2D<adt::i32> spIDs {}; /* empty unless in visibility buffer mode */
+};
+
+/* Widest row group of any kernel build (AVX-512), buffers are padded for it. */
+constexpr int MAX_LANE_WIDTH = 16;
+static_assert(TILE_SIZE % MAX_LANE_WIDTH == 0, "row groups must not cross tiles");
+
+/* visibility buffer value of pixels that no triangle covers */
+constexpr adt::i32 NO_TRIANGLE_I = -1;
+
+/* UNORM depth clear values */
+constexpr adt::i32 UNORM16_DEPTH_MAX = 0xffff;
+constexpr adt::i32 UNORM24_DEPTH_MAX = 0xffffff;
+
+/* stencil value of the first model with an outline, each next one takes the next value */
+constexpr adt::u8 FIRST_OUTLINE_STENCIL = 1;
+
+constexpr int HI_Z_BLOCK_SIZE = IWindow::HI_Z_BLOCK_SIZE;
+static_assert(TILE_SIZE % HI_Z_BLOCK_SIZE == 0, "hi-z blocks must not cross tiles");
+
+/* FXAA: lanes whose local luma range is under max(EDGE_THRESHOLD_MIN, EDGE_THRESHOLD * max luma) stay as they are,
+ * the edge direction is scaled up to SPAN_MAX pixels. */
+constexpr adt::f32 FXAA_EDGE_THRESHOLD = 1.0f / 8.0f;
+constexpr adt::f32 FXAA_EDGE_THRESHOLD_MIN = 1.0f / 16.0f;
+constexpr adt::f32 FXAA_REDUCE_MUL = 1.0f / 8.0f;
+constexpr adt::f32 FXAA_REDUCE_MIN = 1.0f / 128.0f;
+constexpr adt::f32 FXAA_SPAN_MAX = 4.0f;
+
+/* Rows above and below a band that its FXAA taps reach, half the span plus the bilinear footprint. */
+constexpr int FXAA_HALO = static_cast<int>(FXAA_SPAN_MAX) / 2 + 1;
+
+/* inclusive pixel bounds */
+struct Rect
+{
+    int minX {};
+    int minY {};
+    int maxX {};
+    int maxY {};
+};
+
+/* Screen space derivatives of the interpolated uv / w and 1 / w, constant over the triangle. */
+struct TextureGradients
+{
+    adt::math::V2 uvDX {};
+    adt::math::V2 uvDY {};
+    adt::f32 oneOverWDX {};
+    adt::f32 oneOverWDY {};
+};
+
+/* Clipped triangle after perspective divide, ready for binning and raster. */
+struct Triangle
+{
+    clip::Vertex aVertices[3] {}; /* pos.xyz / w, pos.w = 1 / w, uv / w */
+    adt::math::IV2 aPoints[3] {}; /* 24.8 fixed point pixel positions */
+    Rect bbox {};
+    TextureGradients texGrads {};
+    const Image* pTexture {};
+    adt::f32 barycentricDiv {}; /* 256 / doubled area, edge functions times this are the barycentrics */
+    adt::u16 alpha = 256; /* base color factor alpha as a 0-256 weight, BLEND::ALPHA scales texel alpha by it */
+    adt::u8 stencil {}; /* written along with depth in DEPTH_FORMAT::UNORM24_STENCIL8 */
+    bool bSmall {}; /* isSmallTriangle(bbox) */
+};
+
+/* Bboxes up to 4x4 or 8x2 pixels. Setup of the general raster path (64 bit edge start values, hi-z block walk)
+ * costs more than such triangles have pixels, so kernels take a shorter path for them. */
+constexpr bool
+isSmallTriangle(const Rect& bbox)
+{
+    const int width = bbox.maxX - bbox.minX + 1;
+    const int height = bbox.maxY - bbox.minY + 1;
+
+    return (width <= 4 && height <= 4) || (width <= 8 && height <= 2);
+}
+
+/* Screen space part of the setup of a triangle, Kernels::pfnSetupTriangles does it for packets of unclipped ones. */
+struct ProjectedTriangle
+{
+    adt::math::V4 aPos[3] {}; /* pos.xyz / w, pos.w = 1 / w */
+    adt::math::IV2 aPoints[3] {}; /* 24.8 fixed point pixel positions */
+    Rect bbox {}; /* clamped to the screen */
+    bool bSmall {}; /* isSmallTriangle() of the unclamped bbox */
+    adt::i32 triangleI {}; /* index triple in the batch it came from */
+};
+
+/* Post-transform vertex cache: clip space positions of one primitive in SoA layout with their outcodes.
+ * Spans are padded up to a multiple of MAX_LANE_WIDTH so simd stores never need a tail. */
+struct ClipPositions
+{
+    adt::Span<adt::f32> spX {};
+    adt::Span<adt::f32> spY {};
+    adt::Span<adt::f32> spZ {};
+    adt::Span<adt::f32> spW {};
+    adt::Span<adt::u16> spOutcodes {}; /* clip::OUTCODE */
+
+    /* */
+
+    adt::math::V4 operator[](adt::isize i) const { return {spX[i], spY[i], spZ[i], spW[i]}; }
+};
+
+/* Skinned vertices of one primitive, joints and weights are already widened from whatever the accessors store. */
+struct SkinVertices
+{
+    adt::View<const adt::math::V3> vwPos {};
+    adt::Span<const adt::math::IV4> spJoints {}; /* indices into spJointMatrices */
+    adt::Span<const adt::math::V4> spWeights {};
+    adt::Span<const adt::math::M4> spJointMatrices {}; /* Model::Skin::vJointMatrices */
+};
+
+/* Directional light depth rendered with PASS::DEPTH, and how shaded pixels find themselves in it. */
+struct ShadowMap
+{
+    adt::Span2D<const adt::f32> spDepth {};
+    adt::math::M4 trmPixToMap {}; /* target pixel x, y and its depth in [0, 1] to map pixel x, y and light depth, needs the w divide */
+    adt::f32 bias {}; /* in light depth units */
+    adt::i32 shadowWeight {}; /* 0-256 factor of the color of fully shadowed pixels */
+};
+
+using PfnDrawTriangle = void (*)(const Triangle& tri, const adt::i32 triangleI, const Rect tile, RasterTarget target);
+using PfnShadeTile = void (*)(const Triangle* pTriangles, const Rect tile, RasterTarget target);
+using PfnShadowTile = void (*)(const ShadowMap& map, const Rect tile, RasterTarget target);
+
+/* Raster and vertex kernels built once per cpu::ISA level (see kernels.inc), the renderer picks a table in init(). */
+struct Kernels
+{
+    int laneWidth {};
+
+    /* Fills pRes (already allocated) with clip space positions and outcodes,
+     * guardX / guardY are the guard band extents in multiples of w. */
+    void (*pfnTransformPositions)(
+        ClipPositions* pRes, const adt::math::M4& trm, const adt::View<const adt::math::V3> vwPos,
+        const adt::f32 guardX, const adt::f32 guardY
+    );
+
+    /* Blends the four joint matrices per vertex and writes skinned positions of [firstI, endI) into spRes. */
+    void (*pfnSkinPositions)(adt::Span<adt::math::V3> spRes, const SkinVertices& skin, const adt::isize firstI, const adt::isize endI);
+
+    /* Projects the triangles of vwIndices (index triples into pos) that need no clipping and bounds them by width x height pixels.
+     * Writes the ones that may face the camera into pRes, which has room for all of them, returns how many. */
+    adt::isize (*pfnSetupTriangles)(
+        ProjectedTriangle* pRes, const ClipPositions& pos, const adt::View<const adt::i32> vwIndices,
+        const int width, const int height
+    );
+
+    /* Bilinear upscale of spSrc over all of spDst, rows [firstY, endY) of spDst.
+     * Writes whole row groups, spDst stride needs MAX_LANE_WIDTH - 1 pixels of padding. */
+    void (*pfnBlitBilinear)(
+        adt::Span2D<ImagePixelRGBA> spDst, const adt::Span2D<const ImagePixelRGBA> spSrc, const int firstY, const int endY
+    );
+
+    /* Blends color over spDst by its alpha times the 0-256 weights of spCoverage (same size), all 256 if spCoverage is empty.
+     * Whole row groups, lanes past the width store what they loaded, so spDst needs MAX_LANE_WIDTH - 1 pixels of row padding. */
+    void (*pfnBlendCoverage)(
+        adt::Span2D<ImagePixelRGBA> spDst, const adt::Span2D<const adt::i32> spCoverage, const ImagePixelRGBA color
+    );
+
+    /* Maps the RGB of spSrc through pLut (3 x 256 entries, R G B, already shifted into place) into spDst, keeps alpha.
+     * Writes the luma of the result into spLuma, plus a copy of the edge pixels at x = -1 and x = width.
+     * Whole row groups, spLuma rows need MAX_LANE_WIDTH floats of padding on both sides. */
+    void (*pfnToneMap)(
+        adt::Span2D<ImagePixelRGBA> spDst, const adt::Span2D<const ImagePixelRGBA> spSrc,
+        adt::Span2D<adt::f32> spLuma, const adt::i32* pLut
+    );
+
+    /* FXAA of the toneMap() output spSrc / spLuma into spDst, dst row y is src row y + srcFirstY.
+     * spSrc has FXAA_HALO rows around those where it has them, taps clamp to its edges. Whole row groups. */
+    void (*pfnFxaa)(
+        adt::Span2D<ImagePixelRGBA> spDst, const adt::Span2D<const ImagePixelRGBA> spSrc,
+        const adt::Span2D<const adt::f32> spLuma, const int srcFirstY
+    );
+
+    /* Resolve the state to a kernel instantiation once per draw. */
+    PfnDrawTriangle (*pfnSelectDrawTriangle)(const RasterState& state);
+    PfnShadeTile (*pfnSelectShadeTile)(const RasterState& state);
+
+    /* Darkens the covered pixels of the tile by their 2x2 PCF lookup of the map, per RasterState::eDepthFormat. */
+    PfnShadowTile (*pfnSelectShadowTile)(const RasterState& state);
+};
+
+extern const Kernels g_kernelsSSE4_2;
+extern const Kernels g_kernelsAVX2;
+extern const Kernels g_kernelsAVX512;
+
+/* Table for the detected cpu::ISA level, set in Renderer::init(). */
+extern const Kernels* g_pKernels;
+inline const Kernels& kernels() { return *g_pKernels; }
+
+} /* namespace render::sw */
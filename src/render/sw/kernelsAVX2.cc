@@ -0,0 +1,25 @@
+/* Built with -mavx2 -mfma and ADT_AVX2 (see CMakeLists.txt). */
+
+#include "kernels.hh"
+
+#include "adt/simd.hh"
+
+#include <bit>
+
+using namespace adt;
+
+namespace render::sw::avx2
+{
+
+constexpr int LANE_WIDTH = 8;
+
+#include "kernels.inc"
+
+} /* namespace render::sw::avx2 */
+
+namespace render::sw
+{
+
+const Kernels g_kernelsAVX2 = avx2::KERNELS;
+
+} /* namespace render::sw */
@@ -0,0 +1,25 @@
+/* Built with the baseline flags. */
+
+#include "kernels.hh"
+
+#include "adt/simd.hh"
+
+#include <bit>
+
+using namespace adt;
+
+namespace render::sw::sse4_2
+{
+
+constexpr int LANE_WIDTH = 4;
+
+#include "kernels.inc"
+
+} /* namespace render::sw::sse4_2 */
+
+namespace render::sw
+{
+
+const Kernels g_kernelsSSE4_2 = sse4_2::KERNELS;
+
+} /* namespace render::sw */
@@ -0,0 +1,139 @@
+#include "post.hh"
+
+#include "app.hh"
+#include "kernels.hh"
+#include "sw.hh"
+
+#include "adt/StdAllocator.hh"
+#include "adt/atomic.hh"
+
+#include <cmath>
+
+using namespace adt;
+
+namespace render::sw::post
+{
+
+/* R, G and B entries of the whole color chain, already shifted into place for pfnToneMap. */
+static i32 s_aLut[3 * 256] {};
+static f32 s_lutExposure = -1.0f;
+
+/* One slot per running job: its band plus the FXAA_HALO rows around it, tonemapped, and their luma. */
+static Vec<ImagePixelRGBA> s_vScratchColor {};
+static Vec<f32> s_vScratchLuma {};
+
+struct DrawBandsArg
+{
+    Span2D<ImagePixelRGBA> spDst {};
+    Span2D<const ImagePixelRGBA> spSrc {};
+    int nBands {};
+    int scratchHeight {};
+    int lumaStride {}; /* MAX_LANE_WIDTH of padding on both sides */
+    atomic::Int atomNextBandI {};
+    atomic::Int atomNextScratchI {};
+};
+
+static f32
+srgbToLinear(const f32 x)
+{
+    return x <= 0.04045f ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+}
+
+static f32
+linearToSrgb(const f32 x)
+{
+    return x <= 0.0031308f ? x * 12.92f : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+}
+
+/* Narkowicz's fit of the ACES filmic curve. */
+static f32
+acesFilm(const f32 x)
+{
+    return utils::clamp((x*(2.51f*x + 0.03f)) / (x*(2.43f*x + 0.59f) + 0.14f), 0.0f, 1.0f);
+}
+
+/* The framebuffer holds 8 bit sRGB, so decode, exposure, tonemap and encode are one function of each channel byte. */
+static void
+updateLut(const f32 exposure)
+{
+    if (exposure == s_lutExposure) return;
+
+    s_lutExposure = exposure;
+
+    for (int i = 0; i < 256; ++i)
+    {
+        const f32 mapped = acesFilm(srgbToLinear(static_cast<f32>(i) / 255.0f) * exposure);
+        const i32 encoded = static_cast<i32>(std::round(linearToSrgb(mapped) * 255.0f));
+
+        s_aLut[i] = encoded;
+        s_aLut[256 + i] = encoded << 8;
+        s_aLut[512 + i] = encoded << 16;
+    }
+}
+
+/* Bands of TILE_SIZE rows, the halo rows come from spSrc, so bands never read what another one writes. */
+static THREAD_STATUS
+drawBands(void* pArg)
+{
+    auto& arg = *static_cast<DrawBandsArg*>(pArg);
+    const int width = arg.spDst.width();
+    const int height = arg.spDst.height();
+    const int stride = arg.spSrc.stride();
+
+    const int scratchI = arg.atomNextScratchI.fetchAdd(1, atomic::ORDER::RELAXED);
+    ImagePixelRGBA* pColor = &s_vScratchColor[scratchI * arg.scratchHeight * stride];
+    f32* pLuma = &s_vScratchLuma[scratchI * arg.scratchHeight * arg.lumaStride] + MAX_LANE_WIDTH;
+
+    int bandI;
+    while ((bandI = arg.atomNextBandI.fetchAdd(1, atomic::ORDER::RELAXED)) < arg.nBands)
+    {
+        const int minY = bandI * TILE_SIZE;
+        const int endY = utils::min(minY + TILE_SIZE, height);
+        const int firstSrcY = utils::max(minY - FXAA_HALO, 0);
+        const int srcHeight = utils::min(endY + FXAA_HALO, height) - firstSrcY;
+
+        const Span2D<ImagePixelRGBA> spColor {pColor, width, srcHeight, stride};
+        const Span2D<f32> spLuma {pLuma, width, srcHeight, arg.lumaStride};
+
+        kernels().pfnToneMap(spColor, {&arg.spSrc(0, firstSrcY), width, srcHeight, stride}, spLuma, s_aLut);
+        kernels().pfnFxaa({&arg.spDst(0, minY), width, endY - minY, arg.spDst.stride()}, spColor, spLuma, minY - firstSrcY);
+    }
+
+    return THREAD_STATUS(0);
+}
+
+void
+draw(Span2D<ImagePixelRGBA> spDst, const Span2D<const ImagePixelRGBA> spSrc)
+{
+    if (spDst.width() <= 0 || spDst.height() <= 0) return;
+
+    updateLut(g_exposure);
+
+    DrawBandsArg arg {
+        .spDst = spDst,
+        .spSrc = spSrc,
+        .nBands = (static_cast<int>(spDst.height()) + TILE_SIZE - 1) / TILE_SIZE,
+        .scratchHeight = TILE_SIZE + 2*FXAA_HALO,
+        .lumaStride = static_cast<int>(spSrc.stride()) + 2*MAX_LANE_WIDTH,
+    };
+
+    const int nHelpers = utils::min(app::g_threadPool.nThreads(), arg.nBands - 1);
+    s_vScratchColor.setSize(StdAllocator::inst(), (nHelpers + 1) * arg.scratchHeight * spSrc.stride());
+    s_vScratchLuma.setSize(StdAllocator::inst(), (nHelpers + 1) * arg.scratchHeight * arg.lumaStride);
+
+    for (int i = 0; i < nHelpers; ++i)
+        app::g_threadPool.addRetry(drawBands, &arg);
+
+    /* main thread takes bands too */
+    drawBands(&arg);
+    app::g_threadPool.wait();
+}
+
+void
+destroy()
+{
+    s_vScratchColor.destroy(StdAllocator::inst());
+    s_vScratchLuma.destroy(StdAllocator::inst());
+}
+
+} /* namespace render::sw::post */
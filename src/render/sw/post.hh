@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Image.hh"
+
+namespace render::sw::post
+{
+
+/* Exposure (g_exposure) and tonemap, sRGB encode and FXAA of spSrc into spDst (same size, bottom row first).
+ * Runs after raster and before the ui, spSrc is not modified. */
+void draw(adt::Span2D<ImagePixelRGBA> spDst, const adt::Span2D<const ImagePixelRGBA> spSrc);
+void destroy();
+
+} /* namespace render::sw::post */
@@ -1,797 +1,1784 @@
 #include "sw.hh"
 
+#include "Model.hh"
 #include "app.hh"
 #include "asset.hh"
 #include "clip.hh"
 #include "common.hh"
 #include "control.hh"
+#include "cpu/cpu.hh"
+#include "frame.hh"
 #include "game/game.hh"
-#include "gltf/gltf.hh"
+#include "kernels.hh"
+#include "post.hh"
+#include "swui.hh"
 
+#include "adt/StdAllocator.hh"
+#include "adt/Vec.hh"
+#include "adt/atomic.hh"
 #include "adt/file.hh"
+#include "adt/logs.hh"
+#include "adt/simd.hh"
+#include "adt/sort.hh"
 
 using namespace adt;
 
 namespace render::sw
 {
 
-enum class SAMPLER : u8 { NEAREST, BILINEAR };
+const Kernels* g_pKernels = &g_kernelsSSE4_2;
 
-struct IndexU16x3 { u16 x, y, z; };
-struct IndexU32x3 { u32 x, y, z; };
+DEPTH_FORMAT g_eDepthFormat = DEPTH_FORMAT::F32;
+
+/* Outline ring width in pixels around the pixels of an outlined model. */
+constexpr int OUTLINE_WIDTH = 3;
+
+f32 g_frameBudgetMS = 0.0f;
+
+bool g_bTrilinearFiltering = false;
+bool g_bVisibilityBuffer = false;
+
+bool g_bPostProcess = false;
+f32 g_exposure = 1.0f;
+
+bool g_bShadows = false;
+
+/* The shadow map is an orthographic view of game::g_dirLight, fitted to the casters over the view frustum up to SHADOW_DISTANCE.
+ * Its side follows the larger render axis, in whole tiles between MIN_SHADOW_MAP_SIZE and MAX_SHADOW_MAP_SIZE. */
+constexpr f32 SHADOW_DISTANCE = 40.0f;
+constexpr int MIN_SHADOW_MAP_SIZE = 4 * TILE_SIZE;
+constexpr int MAX_SHADOW_MAP_SIZE = 1024;
+static_assert(MAX_SHADOW_MAP_SIZE % TILE_SIZE == 0 && MAX_SHADOW_MAP_SIZE <= MAX_RASTER_EXTENT);
+
+/* The fitted rect snaps to 1/SHADOW_SNAP_STEPS of its size (rounded to a power of two),
+ * so that small camera moves keep the same projection and the cached map. */
+constexpr f32 SHADOW_SNAP_STEPS = 16.0f;
+
+/* Against self shadowing, in light depth per map texel: caster depth gets pushed away by its slope (2x2 PCF reads up to
+ * a texel away), capped for grazing triangles, and lookups get a constant texel sized offset. */
+constexpr f32 SHADOW_SLOPE_BIAS = 1.5f;
+constexpr f32 SHADOW_MAX_SLOPE_BIAS = 8.0f;
+constexpr f32 SHADOW_CONSTANT_BIAS = 1.0f;
+
+/* Lowest fraction of the window size per axis that the render scale goes down to. */
+constexpr f32 MIN_RENDER_SCALE = 0.25f;
+
+/* Rows per upscale job. */
+constexpr int BLIT_CHUNK_HEIGHT = 32;
+
+static f32 s_renderScale = 1.0f;
+static f32 s_avgDrawTimeMS = 0.0f;
+
+/* Size that gets rasterized this frame, top left part of the window sized buffers. */
+static int s_renderWidth = 1;
+static int s_renderHeight = 1;
+
+/* Scaled color target for windows that can't present a sub rect, upscaled into surfaceBuffer() after raster. */
+static Vec<ImagePixelRGBA> s_vScaledColor {};
+
+/* Raster target while g_bPostProcess is on, post::draw() reads it and writes the presented buffer. */
+static Vec<ImagePixelRGBA> s_vPostColor {};
+
+/* Per tile, whether last frame left anything but the clear color in it. Tiles that are plain clear in both frames
+ * are left out of the damage, sized for s_damageWidth x s_damageHeight (0 after an upscaled frame). */
+static Vec<u8> s_vDrawnTiles {};
+static int s_damageWidth = 0;
+static int s_damageHeight = 0;
+static bool s_bDamagePostProcess = false; /* toggling it changes every pixel */
+
+/* s_shadowMapSize square, rasterized again only when s_shadowHash of its inputs changes. */
+static Vec<f32> s_vShadowDepth {};
+static Vec<f32> s_vShadowHiZ {};
+static int s_shadowMapSize = 0;
+static usize s_shadowHash = 0;
+static Vec<Triangle> s_vShadowTriangles {}; /* kept between frames, so the setup doesn't grow new arena blocks each time */
+
+/* Triangle indices sorted by tile, in submission order within each tile. */
+struct Bins
+{
+    int nTilesX {};
+    int nTilesY {};
+    Span<u32> spOffsets {}; /* nTilesX*nTilesY + 1 prefix sums into spTriangleIs */
+    Span<u32> spTriangleIs {};
+};
 
 static math::V2
-ndcToPix(math::V2 ndcPos)
+ndcToPix(math::V2 ndcPos, const int width, const int height)
 {
     using namespace adt::math;
-    const auto& win = *app::g_pWindow;
-
     V2 res = 0.5f * (ndcPos + V2{1.0f, 1.0f});
     res *= V2{
-        static_cast<f32>(win.m_width),
-        static_cast<f32>(win.m_height)
+        static_cast<f32>(width),
+        static_cast<f32>(height)
     };
 
     return res;
 }
 
-[[maybe_unused]] ADT_NO_UB static void
-drawTriangleSSE(
-    clip::Vertex vertex0, clip::Vertex vertex1, clip::Vertex vertex2,
-    const Span2D<ImagePixelRGBA> spTexture,
-    const SAMPLER eSampler
+/* Scalar Kernels::pfnSetupTriangles for one triangle, the kernel mirrors it step by step. */
+static ProjectedTriangle
+projectTriangle(
+    const clip::Vertex& vertex0, const clip::Vertex& vertex1, const clip::Vertex& vertex2,
+    const int width, const int height
 )
 {
     using namespace adt::math;
 
-    auto& win = *app::g_pWindow;
-    Span2D sp = win.surfaceBuffer();
-    Span2D spDepth = win.depthBuffer();
-
-    vertex0.pos.w = 1.0f / vertex0.pos.w;
-    vertex1.pos.w = 1.0f / vertex1.pos.w;
-    vertex2.pos.w = 1.0f / vertex2.pos.w;
+    ProjectedTriangle res {};
 
-    vertex0.pos.xyz *= vertex0.pos.w;
-    vertex1.pos.xyz *= vertex1.pos.w;
-    vertex2.pos.xyz *= vertex2.pos.w;
-
-    vertex0.uv *= vertex0.pos.w;
-    vertex1.uv *= vertex1.pos.w;
-    vertex2.uv *= vertex2.pos.w;
+    const clip::Vertex* apVertices[3] {&vertex0, &vertex1, &vertex2};
+    V2 aPix[3] {};
+    for (int i = 0; i < 3; ++i)
+    {
+        V4 pos = apVertices[i]->pos;
+        pos.w = 1.0f / pos.w;
+        pos.xyz *= pos.w;
 
-    const V2 fPointA = ndcToPix(vertex0.pos.xy);
-    const V2 fPointB = ndcToPix(vertex1.pos.xy);
-    const V2 fPointC = ndcToPix(vertex2.pos.xy);
+        res.aPos[i] = pos;
+        aPix[i] = ndcToPix(pos.xy, width, height);
+        res.aPoints[i] = IV2_F24_8(aPix[i]);
+    }
 
     int minX = utils::min(
-        utils::min(static_cast<int>(fPointA.x), static_cast<int>(fPointB.x)),
-        static_cast<int>(fPointC.x)
+        utils::min(static_cast<int>(aPix[0].x), static_cast<int>(aPix[1].x)),
+        static_cast<int>(aPix[2].x)
     );
     int maxX = utils::max(
-        utils::max(static_cast<int>(std::round(fPointA.x)), static_cast<int>(std::round(fPointB.x))),
-        static_cast<int>(std::round(fPointC.x))
+        utils::max(static_cast<int>(std::round(aPix[0].x)), static_cast<int>(std::round(aPix[1].x))),
+        static_cast<int>(std::round(aPix[2].x))
     );
     int minY = utils::min(
-        utils::min(static_cast<int>(fPointA.y), static_cast<int>(fPointB.y)),
-        static_cast<int>(fPointC.y)
+        utils::min(static_cast<int>(aPix[0].y), static_cast<int>(aPix[1].y)),
+        static_cast<int>(aPix[2].y)
     );
     int maxY = utils::max(
-        utils::max(static_cast<int>(std::round(fPointA.y)), static_cast<int>(std::round(fPointB.y))),
-        static_cast<int>(std::round(fPointC.y))
+        utils::max(static_cast<int>(std::round(aPix[0].y)), static_cast<int>(std::round(aPix[1].y))),
+        static_cast<int>(std::round(aPix[2].y))
     );
 
-    minX = utils::clamp(minX, 0, static_cast<int>(sp.getWidth() - 1));
-    maxX = utils::clamp(maxX, 0, static_cast<int>(sp.getWidth() - 1));
-    minY = utils::clamp(minY, 0, static_cast<int>(sp.getHeight() - 1));
-    maxY = utils::clamp(maxY, 0, static_cast<int>(sp.getHeight() - 1));
+    /* before clamping, so edge functions of small triangles are bounded by their real extent */
+    res.bSmall = isSmallTriangle({minX, minY, maxX, maxY});
 
-    const IV2 pointA = IV2_F24_8(fPointA);
-    const IV2 pointB = IV2_F24_8(fPointB);
-    const IV2 pointC = IV2_F24_8(fPointC);
+    minX = utils::clamp(minX, 0, width - 1);
+    maxX = utils::clamp(maxX, 0, width - 1);
+    minY = utils::clamp(minY, 0, height - 1);
+    maxY = utils::clamp(maxY, 0, height - 1);
 
-    const IV2 edge0 = pointB - pointA;
-    const IV2 edge1 = pointC - pointB;
-    const IV2 edge2 = pointA - pointC;
+    res.bbox = {minX, minY, maxX, maxY};
 
-    /* discard backfaces early */
-    if (IV2Cross(edge0, pointC - pointA) > 0)
-        return;
+    return res;
+}
+
+/* Exact back face test and the per triangle rest of the setup, aUVs are not divided by w yet. */
+static void
+setupTriangle(
+    Vec<Triangle>* pVTriangles, IAllocator* pAlloc,
+    const ProjectedTriangle& proj, const math::V2 (&aUVs)[3],
+    const Image* pTexture
+)
+{
+    using namespace adt::math;
 
-    const bool bTopLeft0 = (edge0.y > 0) || (edge0.x > 0 && edge0.y == 0);
-    const bool bTopLeft1 = (edge1.y > 0) || (edge1.x > 0 && edge1.y == 0);
-    const bool bTopLeft2 = (edge2.y > 0) || (edge2.x > 0 && edge2.y == 0);
+    const IV2 pointA = proj.aPoints[0];
+    const IV2 pointB = proj.aPoints[1];
+    const IV2 pointC = proj.aPoints[2];
 
-    const simd::f32x4 barycentricDiv = 256.0f / static_cast<f32>(IV2Cross(pointB - pointA, pointC - pointA));
+    /* discard backfaces and degenerate triangles early */
+    const i64 area = IV2Cross(pointB - pointA, pointC - pointA);
+    if (area >= 0)
+        return;
 
-    simd::i32x4 edge0DiffX = edge0.y;
-    simd::i32x4 edge1DiffX = edge1.y;
-    simd::i32x4 edge2DiffX = edge2.y;
+    const clip::Vertex vertex0 {proj.aPos[0], aUVs[0] * proj.aPos[0].w};
+    const clip::Vertex vertex1 {proj.aPos[1], aUVs[1] * proj.aPos[1].w};
+    const clip::Vertex vertex2 {proj.aPos[2], aUVs[2] * proj.aPos[2].w};
 
-    const simd::i32x4 edge0DiffY = -edge0.x;
-    const simd::i32x4 edge1DiffY = -edge1.x;
-    const simd::i32x4 edge2DiffY = -edge2.x;
+    /* Raster barycentrics are t0 = -edge1*div, t1 = -edge2*div, t2 = -edge0*div,
+     * a pixel step changes each edge function by (edge.y, -edge.x). */
+    const f32 div = 256.0f / static_cast<f32>(area);
 
-    simd::i32x4 edge0RowY {};
-    simd::i32x4 edge1RowY {};
-    simd::i32x4 edge2RowY {};
+    TextureGradients texGrads {};
     {
-        IV2 startPos = IV2_F24_8(V2From(minX, minY) + V2{0.5f, 0.5f});
-        i64 edge0RowY64 = IV2Cross(startPos - pointA, edge0);
-        i64 edge1RowY64 = IV2Cross(startPos - pointB, edge1);
-        i64 edge2RowY64 = IV2Cross(startPos - pointC, edge2);
+        const IV2 edge0 = pointB - pointA;
+        const IV2 edge1 = pointC - pointB;
+        const IV2 edge2 = pointA - pointC;
 
-        i32 edge0RowY32 = i32((edge0RowY64 + math::sign(edge0RowY64)*128) / 256) - (bTopLeft0 ? 0 : -1);
-        i32 edge1RowY32 = i32((edge1RowY64 + math::sign(edge1RowY64)*128) / 256) - (bTopLeft1 ? 0 : -1);
-        i32 edge2RowY32 = i32((edge2RowY64 + math::sign(edge2RowY64)*128) / 256) - (bTopLeft2 ? 0 : -1);
+        const V3 tDX = V3{-(f32)edge1.y, -(f32)edge2.y, -(f32)edge0.y} * div;
+        const V3 tDY = V3{(f32)edge1.x, (f32)edge2.x, (f32)edge0.x} * div;
 
-        edge0RowY = simd::i32x4(edge0RowY32) + simd::i32x4(0, 1, 2, 3) * edge0DiffX;
-        edge1RowY = simd::i32x4(edge1RowY32) + simd::i32x4(0, 1, 2, 3) * edge1DiffX;
-        edge2RowY = simd::i32x4(edge2RowY32) + simd::i32x4(0, 1, 2, 3) * edge2DiffX;
+        texGrads.uvDX = tDX.x*vertex0.uv + tDX.y*vertex1.uv + tDX.z*vertex2.uv;
+        texGrads.uvDY = tDY.x*vertex0.uv + tDY.y*vertex1.uv + tDY.z*vertex2.uv;
+        texGrads.oneOverWDX = tDX.x*vertex0.pos.w + tDX.y*vertex1.pos.w + tDX.z*vertex2.pos.w;
+        texGrads.oneOverWDY = tDY.x*vertex0.pos.w + tDY.y*vertex1.pos.w + tDY.z*vertex2.pos.w;
     }
 
-    edge0DiffX *= 4;
-    edge1DiffX *= 4;
-    edge2DiffX *= 4;
+    pVTriangles->push(pAlloc, {
+        .aVertices {vertex0, vertex1, vertex2},
+        .aPoints {pointA, pointB, pointC},
+        .bbox = proj.bbox,
+        .texGrads = texGrads,
+        .pTexture = pTexture,
+        .barycentricDiv = div,
+        .bSmall = proj.bSmall,
+    });
+}
 
-    for (int y = minY; y <= maxY; ++y)
-    {
-        simd::i32x4 edge0RowX = edge0RowY;
-        simd::i32x4 edge1RowX = edge1RowY;
-        simd::i32x4 edge2RowX = edge2RowY;
+static void
+setupTriangle(
+    Vec<Triangle>* pVTriangles, IAllocator* pAlloc,
+    const clip::Vertex& vertex0, const clip::Vertex& vertex1, const clip::Vertex& vertex2,
+    const Image* pTexture, const int width, const int height
+)
+{
+    const math::V2 aUVs[3] {vertex0.uv, vertex1.uv, vertex2.uv};
+    setupTriangle(pVTriangles, pAlloc, projectTriangle(vertex0, vertex1, vertex2, width, height), aUVs, pTexture);
+}
 
-        for (int x = minX; x <= maxX; x += 4)
-        {
-            i32* pColor = &sp(x, y).iData;
-            f32* pDepth = &spDepth(x, y);
-            const simd::i32x4 pixelColors = simd::i32x4Load(pColor);
-            const simd::f32x4 pixelDepths = simd::f32x4Load(pDepth);
+/* Clips the triangle against planeMask planes, resulting fan is appended to pVTriangles. */
+static void
+clipTriangle(
+    Vec<Triangle>* pVTriangles, IAllocator* pAlloc,
+    const clip::Vertex& v0, const clip::Vertex& v1, const clip::Vertex& v2,
+    const u16 planeMask,
+    const Image* pTexture, const int width, const int height
+)
+{
+    clip::Polygon poly {v0, v1, v2};
+    clip::polygon(&poly, planeMask);
 
-            simd::i32x4 edgeMask = (edge0RowX | edge1RowX | edge2RowX) >= 0;
+    for (int i = 1; i + 1 < poly.nIndices; ++i)
+        setupTriangle(pVTriangles, pAlloc, poly[0], poly[i], poly[i + 1], pTexture, width, height);
+}
 
-            if (simd::moveMask8(edgeMask) != 0)
-            {
-                const simd::f32x4 t0 = -simd::f32x4(edge1RowX) * barycentricDiv;
-                const simd::f32x4 t1 = -simd::f32x4(edge2RowX) * barycentricDiv;
-                const simd::f32x4 t2 = -simd::f32x4(edge0RowX) * barycentricDiv;
+[[maybe_unused]] static void
+helloGradientTest()
+{
+    auto& win = *app::g_pWindow;
+    Span2D sp = win.surfaceBuffer();
+
+    static int frame = 0;
 
-                const simd::f32x4 depthZ = vertex0.pos.z + t1*(vertex1.pos.z - vertex0.pos.z) + t2*(vertex2.pos.z - vertex0.pos.z);
-                const simd::i32x4 depthMask = simd::i32x4Reinterpret(depthZ < pixelDepths);
+    for (isize y = 0; y < sp.height(); ++y)
+    {
+        for (isize x = 0; x < sp.width(); ++x)
+        {
+            ImagePixelRGBA pix;
+            pix.r = 255;
+            pix.g = static_cast<u8>(x);
+            pix.b = static_cast<u8>(x + frame);
+            pix.a = static_cast<u8>(y - frame);
 
-                const simd::f32x4 oneOverW = t0*vertex0.pos.w + t1*vertex1.pos.w + t2*vertex2.pos.w;
+            sp(x, y).data = pix.data;
+        }
+    }
 
-                simd::V2x4 uv = t0*vertex0.uv + t1*vertex1.uv + t2*vertex2.uv;
-                uv /= oneOverW;
+    ++frame;
+}
 
-                simd::i32x4 texelColor {};
+static const Image*
+defaultTexture()
+{
+    static const Image s_img {
+        .m_uData {.pRGBA = const_cast<ImagePixelRGBA*>(common::g_spDefaultTexture.data())},
+        .m_width = static_cast<i16>(common::g_spDefaultTexture.width()),
+        .m_height = static_cast<i16>(common::g_spDefaultTexture.height()),
+        .m_eType = Image::TYPE::RGBA,
+    };
 
-                switch (eSampler)
-                {
-                    case SAMPLER::NEAREST:
-                    {
-                        simd::i32x4 texelX = simd::i32x4(simd::floor(uv.x * (spTexture.getWidth() - 1)));
-                        simd::i32x4 texelY = simd::i32x4(simd::floor(uv.y * (spTexture.getHeight() - 1)));
+    return &s_img;
+}
 
-                        const simd::i32x4 texelMask = (
-                            (texelX >= 0) & (texelX < spTexture.getWidth()) &
-                            (texelY >= 0) & (texelY < spTexture.getHeight())
-                        );
+static const Image*
+primitiveTexture(Arena* pArena, const Model& model, const gltf::Primitive& primitive)
+{
+    const auto& gltfModel = model.gltfModel();
 
-                        texelX = simd::max(simd::min(texelX, spTexture.getWidth() - 1), 0);
-                        texelY = simd::max(simd::min(texelY, spTexture.getHeight() - 1), 0);
-                        simd::i32x4 texelOffsets = texelY * spTexture.getWidth() + texelX;
+    if (primitive.materialI < 0) return defaultTexture();
 
-                        const simd::i32x4 trueCase = simd::i32x4Gather((i32*)spTexture.data(), texelOffsets);
-                        const simd::i32x4 falseCase = 0xff00ff00;
+    const auto& mat = gltfModel.m_vMaterials[primitive.materialI];
+    if (mat.pbrMetallicRoughness.baseColorTexture.index < 0) return defaultTexture();
 
-                        texelColor = (trueCase & texelMask) + simd::andNot(texelMask, falseCase);
-                    }
-                    break;
+    const auto& tex = gltfModel.m_vTextures[mat.pbrMetallicRoughness.baseColorTexture.index];
+    const auto& img = gltfModel.m_vImages[tex.sourceI];
 
-                    case SAMPLER::BILINEAR:
-                    {
-                        simd::V2x4 texelV2 = uv *
-                            V2From(spTexture.getWidth(), spTexture.getHeight()) -
-                            V2{0.5f, 0.5f};
-
-                        simd::IV2x4 aTexelPos[4] {};
-                        aTexelPos[0] = simd::IV2x4(simd::floor(texelV2.x), simd::floor(texelV2.y));
-                        aTexelPos[1] = aTexelPos[0] + IV2{1, 0};
-                        aTexelPos[2] = aTexelPos[0] + IV2{0, 1};
-                        aTexelPos[3] = aTexelPos[0] + IV2{1, 1};
-
-                        simd::V3x4 aTexelColors[4] {};
-                        for (int texelI = 0; texelI < utils::size(aTexelPos); ++texelI)
-                        {
-                            simd::IV2x4 currTexelPos = aTexelPos[texelI];
-                            {
-                                simd::V2x4 currTexelPosF = simd::V2x4(currTexelPos);
-                                simd::V2x4 factor = simd::floor(currTexelPosF / V2From(spTexture.getWidth(), spTexture.getHeight()));
-                                currTexelPosF = currTexelPosF - factor * V2From(spTexture.getWidth(), spTexture.getHeight());
-                                currTexelPos = simd::IV2x4(currTexelPosF);
-                            }
+    /* NOTE: must be one of asset::g_poolObjects */
+    const auto* pObj = reinterpret_cast<const asset::Object*>(&gltfModel);
 
-                            simd::i32x4 texelOffsets = currTexelPos.y * spTexture.getWidth() + currTexelPos.x;
-                            simd::i32x4 loadMask = edgeMask & depthMask;
-                            texelOffsets = (texelOffsets & loadMask) + simd::andNot(loadMask, simd::i32x4(0));
-                            simd::i32x4 texelColorI32 = simd::i32x4Gather((i32*)spTexture.data(), texelOffsets);
+    const String sPath = file::replacePathEnding(pArena, pObj->m_sMappedWith, img.sUri);
+    const Image* pImg = asset::searchImage(sPath);
+    if (!pImg) return defaultTexture();
 
-                            aTexelColors[texelI] = colorI32x4ToV3x4(texelColorI32);
-                        }
+    return pImg;
+}
 
-                        simd::f32x4 s = texelV2.x - simd::floor(texelV2.x);
-                        simd::f32x4 k = texelV2.y - simd::floor(texelV2.y);
+/* Transforms every vertex of the accessor exactly once, primitive assembly only gathers by index. */
+static ClipPositions
+transformPositions(Arena* pArena, const math::M4& trm, const View<const math::V3> vwPos, const int width, const int height)
+{
+    const isize size = vwPos.size();
+    const isize paddedSize = (size + MAX_LANE_WIDTH - 1) & ~isize(MAX_LANE_WIDTH - 1);
+
+    ClipPositions res {
+        .spX {pArena->mallocV<f32>(paddedSize), paddedSize},
+        .spY {pArena->mallocV<f32>(paddedSize), paddedSize},
+        .spZ {pArena->mallocV<f32>(paddedSize), paddedSize},
+        .spW {pArena->mallocV<f32>(paddedSize), paddedSize},
+        .spOutcodes {pArena->mallocV<u16>(paddedSize), paddedSize},
+    };
 
-                        simd::V3x4 interpolated0 = lerp(aTexelColors[0], aTexelColors[1], s);
-                        simd::V3x4 interpolated1 = lerp(aTexelColors[2], aTexelColors[3], s);
-                        simd::V3x4 finalColor = lerp(interpolated0, interpolated1, k);
+    /* Edge functions are i32 in 24.8 fixed point, which overflow past MAX_RASTER_EXTENT pixels,
+     * so the guard band is whatever is left of that range. A larger target has none left for the screen itself. */
+    ADT_ASSERT(width <= MAX_RASTER_EXTENT && height <= MAX_RASTER_EXTENT, "{}x{} target is past MAX_RASTER_EXTENT", width, height);
 
-                        texelColor = colorV3x4ToI32x4(finalColor);
-                    }
-                    break;
-                }
+    const f32 guardX = utils::max(static_cast<f32>(MAX_RASTER_EXTENT) / static_cast<f32>(width), 1.0f);
+    const f32 guardY = utils::max(static_cast<f32>(MAX_RASTER_EXTENT) / static_cast<f32>(height), 1.0f);
 
-                const simd::i32x4 finalMaskI32 = edgeMask & depthMask;
-                const simd::f32x4 finalMaskF32 = simd::f32x4Reinterpret(finalMaskI32);
-                const simd::i32x4 outputColors = (texelColor & finalMaskI32) + simd::andNot(finalMaskI32, pixelColors);
-                const simd::f32x4 outputDepth = (depthZ & finalMaskF32) + simd::andNot(finalMaskF32, pixelDepths);
+    kernels().pfnTransformPositions(&res, trm, vwPos, guardX, guardY);
 
-                simd::i32x4Store(pColor, outputColors);
-                simd::f32x4Store(pDepth, outputDepth);
-            }
-            edge0RowX += edge0DiffX;
-            edge1RowX += edge1DiffX;
-            edge2RowX += edge2DiffX;
-        }
-        edge0RowY += edge0DiffY;
-        edge1RowY += edge1DiffY;
-        edge2RowY += edge2DiffY;
-    }
+    return res;
 }
 
-#ifdef ADT_AVX2
+/* Vertices per skinning job, one primitive is split into as many as it takes. */
+constexpr isize SKIN_CHUNK_SIZE = 1024;
+static_assert(SKIN_CHUNK_SIZE % MAX_LANE_WIDTH == 0, "chunks must not split row groups");
 
-ADT_NO_UB static void
-drawTriangleAVX2(
-    clip::Vertex vertex0, clip::Vertex vertex1, clip::Vertex vertex2,
-    const Span2D<ImagePixelRGBA> spTexture,
-    const SAMPLER eSampler
-)
+struct SkinChunkArg
 {
-    using namespace adt::math;
-
-    auto& win = *app::g_pWindow;
-    Span2D sp = win.surfaceBuffer();
-    Span2D spDepth = win.depthBuffer();
+    const gltf::Model* pGltfModel {};
+    const gltf::Primitive* pPrimitive {};
+    const SkinVertices* pSkin {};
+    Span<math::IV4> spJoints {}; /* backs pSkin->spJoints */
+    Span<math::V4> spWeights {}; /* backs pSkin->spWeights */
+    Span<math::V3> spRes {};
+    isize firstI {};
+    isize endI {};
+};
+
+/* JOINTS_0 is u8 or u16, WEIGHTS_0 is f32 or normalized u8 / u16. */
+static bool
+skinAttributesSupported(const gltf::Model& gltfModel, const gltf::Primitive& primitive)
+{
+    if (primitive.attributes.JOINTS_0 < 0 || primitive.attributes.WEIGHTS_0 < 0) return false;
 
-    vertex0.pos.w = 1.0f / vertex0.pos.w;
-    vertex1.pos.w = 1.0f / vertex1.pos.w;
-    vertex2.pos.w = 1.0f / vertex2.pos.w;
+    const auto eJoints = gltfModel.m_vAccessors[primitive.attributes.JOINTS_0].eComponentType;
+    const auto eWeights = gltfModel.m_vAccessors[primitive.attributes.WEIGHTS_0].eComponentType;
 
-    vertex0.pos.xyz *= vertex0.pos.w;
-    vertex1.pos.xyz *= vertex1.pos.w;
-    vertex2.pos.xyz *= vertex2.pos.w;
+    return (eJoints == gltf::COMPONENT_TYPE::UNSIGNED_BYTE || eJoints == gltf::COMPONENT_TYPE::UNSIGNED_SHORT) &&
+        (eWeights == gltf::COMPONENT_TYPE::FLOAT ||
+            eWeights == gltf::COMPONENT_TYPE::UNSIGNED_BYTE ||
+            eWeights == gltf::COMPONENT_TYPE::UNSIGNED_SHORT
+        );
+}
 
-    vertex0.uv *= vertex0.pos.w;
-    vertex1.uv *= vertex1.pos.w;
-    vertex2.uv *= vertex2.pos.w;
+/* Widens joints and weights of the chunk into the layout the skinning kernel reads. */
+static void
+widenSkinAttributes(const SkinChunkArg& arg)
+{
+    const gltf::Model& gltfModel = *arg.pGltfModel;
+    const gltf::Primitive& primitive = *arg.pPrimitive;
+    const int lastJointI = static_cast<int>(arg.pSkin->spJointMatrices.size()) - 1;
+    Span<math::IV4> spJoints = arg.spJoints;
+    Span<math::V4> spWeights = arg.spWeights;
 
-    const V2 fPointA = ndcToPix(vertex0.pos.xy);
-    const V2 fPointB = ndcToPix(vertex1.pos.xy);
-    const V2 fPointC = ndcToPix(vertex2.pos.xy);
+    auto clJoints = [&]<typename T>(const View<const T> vwJoints)
+    {
+        for (isize i = arg.firstI; i < arg.endI; ++i)
+        {
+            for (int influenceI = 0; influenceI < 4; ++influenceI)
+                spJoints[i].e[influenceI] = utils::min(static_cast<int>(vwJoints[i].e[influenceI]), lastJointI);
+        }
+    };
 
-    int minX = utils::min(
-        utils::min(static_cast<int>(fPointA.x), static_cast<int>(fPointB.x)),
-        static_cast<int>(fPointC.x)
-    );
-    int maxX = utils::max(
-        utils::max(static_cast<int>(std::round(fPointA.x)), static_cast<int>(std::round(fPointB.x))),
-        static_cast<int>(std::round(fPointC.x))
-    );
-    int minY = utils::min(
-        utils::min(static_cast<int>(fPointA.y), static_cast<int>(fPointB.y)),
-        static_cast<int>(fPointC.y)
-    );
-    int maxY = utils::max(
-        utils::max(static_cast<int>(std::round(fPointA.y)), static_cast<int>(std::round(fPointB.y))),
-        static_cast<int>(std::round(fPointC.y))
-    );
+    auto clWeights = [&]<typename T>(const View<const T> vwWeights, const f32 scale)
+    {
+        for (isize i = arg.firstI; i < arg.endI; ++i)
+        {
+            for (int influenceI = 0; influenceI < 4; ++influenceI)
+                spWeights[i].e[influenceI] = static_cast<f32>(vwWeights[i].e[influenceI]) * scale;
+        }
+    };
 
-    minX = utils::clamp(minX, 0, static_cast<int>(sp.getWidth() - 1));
-    maxX = utils::clamp(maxX, 0, static_cast<int>(sp.getWidth() - 1));
-    minY = utils::clamp(minY, 0, static_cast<int>(sp.getHeight() - 1));
-    maxY = utils::clamp(maxY, 0, static_cast<int>(sp.getHeight() - 1));
+    switch (gltfModel.m_vAccessors[primitive.attributes.JOINTS_0].eComponentType)
+    {
+        default: break; /* rejected in skinMesh() */
 
-    const IV2 pointA = IV2_F24_8(fPointA);
-    const IV2 pointB = IV2_F24_8(fPointB);
-    const IV2 pointC = IV2_F24_8(fPointC);
+        case gltf::COMPONENT_TYPE::UNSIGNED_BYTE:
+        clJoints(gltfModel.accessorView<const math::IV4u8>(primitive.attributes.JOINTS_0));
+        break;
 
-    const IV2 edge0 = pointB - pointA;
-    const IV2 edge1 = pointC - pointB;
-    const IV2 edge2 = pointA - pointC;
+        case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
+        clJoints(gltfModel.accessorView<const math::IV4u16>(primitive.attributes.JOINTS_0));
+        break;
+    }
 
-    /* discard backfaces early */
-    if (IV2Cross(edge0, pointC - pointA) > 0)
-        return;
+    switch (gltfModel.m_vAccessors[primitive.attributes.WEIGHTS_0].eComponentType)
+    {
+        default: break; /* rejected in skinMesh() */
 
-    const bool bTopLeft0 = (edge0.y > 0) || (edge0.x > 0 && edge0.y == 0);
-    const bool bTopLeft1 = (edge1.y > 0) || (edge1.x > 0 && edge1.y == 0);
-    const bool bTopLeft2 = (edge2.y > 0) || (edge2.x > 0 && edge2.y == 0);
+        case gltf::COMPONENT_TYPE::FLOAT:
+        clWeights(gltfModel.accessorView<const math::V4>(primitive.attributes.WEIGHTS_0), 1.0f);
+        break;
 
-    const simd::f32x8 barycentricDiv = 256.0f / static_cast<f32>(IV2Cross(pointB - pointA, pointC - pointA));
+        case gltf::COMPONENT_TYPE::UNSIGNED_BYTE:
+        clWeights(gltfModel.accessorView<const math::IV4u8>(primitive.attributes.WEIGHTS_0), 1.0f / 255.0f);
+        break;
 
-    simd::i32x8 edge0DiffX = edge0.y;
-    simd::i32x8 edge1DiffX = edge1.y;
-    simd::i32x8 edge2DiffX = edge2.y;
+        case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
+        clWeights(gltfModel.accessorView<const math::IV4u16>(primitive.attributes.WEIGHTS_0), 1.0f / 65535.0f);
+        break;
+    }
+}
 
-    const simd::i32x8 edge0DiffY = -edge0.x;
-    const simd::i32x8 edge1DiffY = -edge1.x;
-    const simd::i32x8 edge2DiffY = -edge2.x;
+static THREAD_STATUS
+skinChunk(void* pArg)
+{
+    const auto& arg = *static_cast<SkinChunkArg*>(pArg);
 
-    simd::i32x8 edge0RowY {};
-    simd::i32x8 edge1RowY {};
-    simd::i32x8 edge2RowY {};
-    {
-        IV2 startPos = IV2_F24_8(V2From(minX, minY) + V2{0.5f, 0.5f});
-        i64 edge0RowY64 = IV2Cross(startPos - pointA, edge0);
-        i64 edge1RowY64 = IV2Cross(startPos - pointB, edge1);
-        i64 edge2RowY64 = IV2Cross(startPos - pointC, edge2);
+    widenSkinAttributes(arg);
+    kernels().pfnSkinPositions(arg.spRes, *arg.pSkin, arg.firstI, arg.endI);
 
-        i32 edge0RowY32 = i32((edge0RowY64 + math::sign(edge0RowY64)*128) / 256) - (bTopLeft0 ? 0 : -1);
-        i32 edge1RowY32 = i32((edge1RowY64 + math::sign(edge1RowY64)*128) / 256) - (bTopLeft1 ? 0 : -1);
-        i32 edge2RowY32 = i32((edge2RowY64 + math::sign(edge2RowY64)*128) / 256) - (bTopLeft2 ? 0 : -1);
+    return THREAD_STATUS(0);
+}
 
-        edge0RowY = simd::i32x8(edge0RowY32) + simd::i32x8(0, 1, 2, 3, 4, 5, 6, 7) * edge0DiffX;
-        edge1RowY = simd::i32x8(edge1RowY32) + simd::i32x8(0, 1, 2, 3, 4, 5, 6, 7) * edge1DiffX;
-        edge2RowY = simd::i32x8(edge2RowY32) + simd::i32x8(0, 1, 2, 3, 4, 5, 6, 7) * edge2DiffX;
-    }
+/* Skins every primitive of the mesh on the thread pool, returns skinned positions per primitive (empty if not skinned). */
+static Span<View<const math::V3>>
+skinMesh(Arena* pArena, const Model& model, const gltf::Node& gltfNode)
+{
+    const auto& gltfModel = model.gltfModel();
+    const auto& gltfMesh = gltfModel.m_vMeshes[gltfNode.meshI];
+    const Model::Skin& skin = model.m_vSkins[gltfNode.skinI];
 
-    edge0DiffX *= 8;
-    edge1DiffX *= 8;
-    edge2DiffX *= 8;
+    const isize nPrimitives = gltfMesh.vPrimitives.size();
+    Span<View<const math::V3>> spRes {pArena->zallocV<View<const math::V3>>(nPrimitives), nPrimitives};
+    if (skin.vJointMatrices.empty()) return spRes;
 
-    for (int y = minY; y <= maxY; ++y)
+    for (isize primitiveI = 0; primitiveI < nPrimitives; ++primitiveI)
     {
-        simd::i32x8 edge0RowX = edge0RowY;
-        simd::i32x8 edge1RowX = edge1RowY;
-        simd::i32x8 edge2RowX = edge2RowY;
+        const gltf::Primitive& primitive = gltfMesh.vPrimitives[primitiveI];
+        /* unskinned primitives and unsupported attribute types stay in bind pose */
+        if (!skinAttributesSupported(gltfModel, primitive)) continue;
 
-        for (int x = minX; x <= maxX; x += 8)
-        {
-            i32* pColor = reinterpret_cast<i32*>(&sp(x, y));
-            f32* pDepth = &spDepth(x, y);
-            simd::i32x8 pixelColors;
-            simd::f32x8 pixelDepths;
-            {
-                /*guard::Mtx lock(&s_mtxDepth);*/
-                pixelColors = simd::i32x8Load(pColor);
-                pixelDepths = simd::f32x8Load(pDepth);
-            }
-            /*simd::i32x8 pixelColors = simd::i32x8Load(pColor);*/
-            /*simd::f32x8 pixelDepths = simd::f32x8Load(pDepth);*/
+        const View<const math::V3> vwPos = gltfModel.accessorView<const math::V3>(primitive.attributes.POSITION);
+        const isize size = vwPos.size();
 
-            const simd::i32x8 edgeMask = (edge0RowX | edge1RowX | edge2RowX) >= 0;
+        Span<math::IV4> spJoints {pArena->mallocV<math::IV4>(size), size};
+        Span<math::V4> spWeights {pArena->mallocV<math::V4>(size), size};
+        Span<math::V3> spPos {pArena->mallocV<math::V3>(size), size};
 
-            if (simd::moveMask8(edgeMask) != 0)
-            {
-                const simd::f32x8 t0 = -simd::f32x8(edge1RowX) * barycentricDiv;
-                const simd::f32x8 t1 = -simd::f32x8(edge2RowX) * barycentricDiv;
-                const simd::f32x8 t2 = -simd::f32x8(edge0RowX) * barycentricDiv;
+        auto* pSkin = pArena->alloc<SkinVertices>(SkinVertices {
+            .vwPos = vwPos,
+            .spJoints = spJoints,
+            .spWeights = spWeights,
+            .spJointMatrices = Span<const math::M4>(skin.vJointMatrices),
+        });
 
-                const simd::f32x8 depthZ = vertex0.pos.z + t1*(vertex1.pos.z - vertex0.pos.z) + t2*(vertex2.pos.z - vertex0.pos.z);
-                const simd::i32x8 depthMask = simd::i32x8Reinterpret(depthZ < pixelDepths);
+        for (isize firstI = 0; firstI < size; firstI += SKIN_CHUNK_SIZE)
+        {
+            auto* pArg = pArena->alloc<SkinChunkArg>(SkinChunkArg {
+                .pGltfModel = &gltfModel,
+                .pPrimitive = &primitive,
+                .pSkin = pSkin,
+                .spJoints = spJoints,
+                .spWeights = spWeights,
+                .spRes = spPos,
+                .firstI = firstI,
+                .endI = utils::min(firstI + SKIN_CHUNK_SIZE, size),
+            });
+
+            app::g_threadPool.addRetry(skinChunk, pArg);
+        }
 
-                const simd::f32x8 oneOverW = t0*vertex0.pos.w + t1*vertex1.pos.w + t2*vertex2.pos.w;
+        spRes[primitiveI] = {spPos.data(), size, 0};
+    }
 
-                simd::V2x8 uv = t0*vertex0.uv + t1*vertex1.uv + t2*vertex2.uv;
-                uv /= oneOverW;
+    app::g_threadPool.wait();
 
-                simd::i32x8 texelColor = 0;
+    return spRes;
+}
 
-                switch (eSampler)
-                {
-                    case SAMPLER::NEAREST:
-                    {
-                        simd::i32x8 texelX = simd::i32x8(simd::floor(uv.x * (spTexture.getWidth() - 1)));
-                        simd::i32x8 texelY = simd::i32x8(simd::floor(uv.y * (spTexture.getHeight() - 1)));
+/* Triangles per Kernels::pfnSetupTriangles call. */
+constexpr isize SETUP_BATCH_SIZE = 256;
 
-                        const simd::i32x8 texelMask = (
-                            (texelX >= 0) & (texelX < spTexture.getWidth()) &
-                            (texelY >= 0) & (texelY < spTexture.getHeight())
-                        );
+/* Opaque primitive that drawShadowMap() may rasterize into the map, once the light projection is fitted. */
+struct ShadowCaster
+{
+    const gltf::Model* pGltfModel {};
+    const gltf::Primitive* pPrimitive {};
+    View<const math::V3> vwPos {}; /* skinned ones live in the frame arena */
+    math::M4 trm {}; /* light view times the node transform */
+    bool bSkinned {};
+};
+
+/* Light space output of drawNode(). */
+struct ShadowCasters
+{
+    Vec<ShadowCaster>* pVCasters {};
+    math::M4 trm {}; /* light view times the entity transform */
+};
 
-                        texelX = simd::max(simd::min(texelX, spTexture.getWidth() - 1), 0);
-                        texelY = simd::max(simd::min(texelY, spTexture.getHeight() - 1), 0);
-                        simd::i32x8 texelOffsets = texelY * spTexture.getWidth() + texelX;
+/* Assembles, clips and sets up the triangles of one primitive for a width x height target.
+ * spBatch and spProjected are scratch for SETUP_BATCH_SIZE triangles. */
+static void
+drawPrimitive(
+    Vec<Triangle>* pVOut, IAllocator* pAlloc,
+    const gltf::Model& gltfModel, const gltf::Primitive& primitive, const isize nVertices,
+    const ClipPositions& clipPositions, const View<const math::V2> vwUVs, const Image* pTexture,
+    const int width, const int height,
+    Span<i32> spBatch, Span<ProjectedTriangle> spProjected
+)
+{
+    using namespace adt::math;
 
-                        const simd::i32x8 trueCase = simd::i32x8Gather((i32*)spTexture.data(), texelOffsets);
-                        const simd::i32x8 falseCase = 0xff00ff00;
+    /* Unclipped triangles go through pfnSetupTriangles in batches,
+     * a triangle that needs clipping flushes the batch first to keep the submission order. */
+    isize nBatched = 0;
 
-                        texelColor = (trueCase & texelMask) + simd::andNot(texelMask, falseCase);
-                    }
-                    break;
+    auto clFlush = [&]
+    {
+        const isize nProjected = kernels().pfnSetupTriangles(
+            spProjected.data(), clipPositions, {spBatch.data(), nBatched*3, 0}, width, height
+        );
 
-                    case SAMPLER::BILINEAR:
-                    {
-                        simd::V2x8 texelV2 = uv *
-                            V2From(spTexture.getWidth(), spTexture.getHeight()) -
-                            V2{0.5f, 0.5f};
-
-                        simd::IV2x8 aTexelPos[4] {};
-                        aTexelPos[0] = simd::IV2x8(simd::floor(texelV2.x), simd::floor(texelV2.y));
-                        aTexelPos[1] = aTexelPos[0] + IV2{1, 0};
-                        aTexelPos[2] = aTexelPos[0] + IV2{0, 1};
-                        aTexelPos[3] = aTexelPos[0] + IV2{1, 1};
-
-                        simd::V3x8 aTexelColors[4] {};
-                        for (int texelI = 0; texelI < utils::size(aTexelPos); ++texelI)
-                        {
-                            simd::IV2x8 currTexelPos = aTexelPos[texelI];
-                            {
-                                simd::V2x8 currTexelPosF = simd::V2x8(currTexelPos);
-                                simd::V2x8 factor = simd::floor(currTexelPosF / V2From(spTexture.getWidth(), spTexture.getHeight()));
-                                currTexelPosF = currTexelPosF - factor * V2From(spTexture.getWidth(), spTexture.getHeight());
-                                currTexelPos = simd::IV2x8(currTexelPosF);
-                            }
+        for (isize i = 0; i < nProjected; ++i)
+        {
+            const ProjectedTriangle& proj = spProjected[i];
+            const i32* pIndices = &spBatch[proj.triangleI * 3];
 
-                            simd::i32x8 texelOffsets = currTexelPos.y * spTexture.getWidth() + currTexelPos.x;
-                            simd::i32x8 loadMask = edgeMask & depthMask;
-                            texelOffsets = (texelOffsets & loadMask) + simd::andNot(loadMask, simd::i32x8(0));
-                            simd::i32x8 texelColorI32 = simd::i32x8Gather((i32*)spTexture.data(), texelOffsets);
+            V2 aUVs[3] {};
+            if (!vwUVs.empty())
+            {
+                aUVs[0] = vwUVs[pIndices[0]];
+                aUVs[1] = vwUVs[pIndices[1]];
+                aUVs[2] = vwUVs[pIndices[2]];
+            }
 
-                            aTexelColors[texelI] = colorI32x8ToV3x8(texelColorI32);
-                        }
+            setupTriangle(pVOut, pAlloc, proj, aUVs, pTexture);
+        }
 
-                        simd::f32x8 s = texelV2.x - simd::floor(texelV2.x);
-                        simd::f32x8 k = texelV2.y - simd::floor(texelV2.y);
+        nBatched = 0;
+    };
 
-                        simd::V3x8 interpolated0 = lerp(aTexelColors[0], aTexelColors[1], s);
-                        simd::V3x8 interpolated1 = lerp(aTexelColors[2], aTexelColors[3], s);
-                        simd::V3x8 finalColor = lerp(interpolated0, interpolated1, k);
+    auto clTriangle = [&](const isize i0, const isize i1, const isize i2)
+    {
+        const u16 outcode0 = clipPositions.spOutcodes[i0];
+        const u16 outcode1 = clipPositions.spOutcodes[i1];
+        const u16 outcode2 = clipPositions.spOutcodes[i2];
 
-                        texelColor = colorV3x8ToI32x8(finalColor);
-                    }
-                    break;
-                }
+        /* all vertices are behind the same plane */
+        if (outcode0 & outcode1 & outcode2 & clip::OUT_FRUSTUM) return;
 
-                const simd::i32x8 finalMaskI32 = edgeMask & depthMask;
-                const simd::f32x8 finalMaskF32 = simd::f32x8Reinterpret(finalMaskI32);
-                const simd::i32x8 outputColors = (texelColor & finalMaskI32) + simd::andNot(finalMaskI32, pixelColors);
-                const simd::f32x8 outputDepth = (depthZ & finalMaskF32) + simd::andNot(finalMaskF32, pixelDepths);
+        const u16 planeMask = clip::planesToClip(outcode0 | outcode1 | outcode2);
+        if (planeMask == 0)
+        {
+            spBatch[nBatched*3 + 0] = static_cast<i32>(i0);
+            spBatch[nBatched*3 + 1] = static_cast<i32>(i1);
+            spBatch[nBatched*3 + 2] = static_cast<i32>(i2);
+            if (++nBatched == SETUP_BATCH_SIZE) clFlush();
 
-                {
-                    /*guard::Mtx lock(&s_mtxDepth);*/
-                    simd::i32x8Store(pColor, outputColors);
-                    simd::f32x8Store(pDepth, outputDepth);
-                }
-            }
-            edge0RowX += edge0DiffX;
-            edge1RowX += edge1DiffX;
-            edge2RowX += edge2DiffX;
+            return;
         }
-        edge0RowY += edge0DiffY;
-        edge1RowY += edge1DiffY;
-        edge2RowY += edge2DiffY;
-    }
-}
 
-#endif
+        clFlush();
 
-ADT_NO_UB static void
-drawTriangle(
-    const math::V4 p0, const math::V4 p1, const math::V4 p2,
-    const math::V2 uv0, const math::V2 uv1, const math::V2 uv2,
-    const Span2D<ImagePixelRGBA> spTexture
-)
-{
-    clip::Result ping {};
-    ping.nTriangles = 1;
-    ping.aVertices[0] = {p0, uv0};
-    ping.aVertices[1] = {p1, uv1};
-    ping.aVertices[2] = {p2, uv2};
+        V2 aUVs[3] {};
+        if (!vwUVs.empty())
+        {
+            aUVs[0] = vwUVs[i0];
+            aUVs[1] = vwUVs[i1];
+            aUVs[2] = vwUVs[i2];
+        }
 
-    clip::Result pong {};
+        const clip::Vertex vertex0 {clipPositions[i0], aUVs[0]};
+        const clip::Vertex vertex1 {clipPositions[i1], aUVs[1]};
+        const clip::Vertex vertex2 {clipPositions[i2], aUVs[2]};
 
-    clip::polygonToAxis(&ping, &pong, clip::AXIS::LEFT);
-    clip::polygonToAxis(&pong, &ping, clip::AXIS::RIGHT);
-    clip::polygonToAxis(&ping, &pong, clip::AXIS::TOP);
-    clip::polygonToAxis(&pong, &ping, clip::AXIS::BOTTOM);
-    clip::polygonToAxis(&ping, &pong, clip::AXIS::NEAR);
-    clip::polygonToAxis(&pong, &ping, clip::AXIS::FAR);
-    clip::polygonToAxis(&ping, &pong, clip::AXIS::W);
+        clipTriangle(pVOut, pAlloc, vertex0, vertex1, vertex2, planeMask, pTexture, width, height);
+    };
 
-    for (int triangleIdx = 0; triangleIdx < pong.nTriangles; ++triangleIdx)
+    auto clIndexed = [&]<typename T>(const View<const T> vwIndices)
     {
-        auto v0 = pong.aVertices[3*triangleIdx + 0];
-        auto v1 = pong.aVertices[3*triangleIdx + 1];
-        auto v2 = pong.aVertices[3*triangleIdx + 2];
+        for (isize i = 0; i + 2 < vwIndices.size(); i += 3)
+            clTriangle(vwIndices[i + 0], vwIndices[i + 1], vwIndices[i + 2]);
+    };
 
-#ifdef ADT_AVX2
-        drawTriangleAVX2(v0, v1, v2, spTexture, SAMPLER::BILINEAR);
-#else
-        drawTriangleSSE(v0, v1, v2, spTexture, SAMPLER::BILINEAR);
-#endif /* ADT_AVX2 */
+    if (primitive.indicesI < 0)
+    {
+        for (isize i = 0; i + 2 < nVertices; i += 3)
+            clTriangle(i + 0, i + 1, i + 2);
     }
-}
-
-[[maybe_unused]] static void
-helloGradientTest()
-{
-    auto& win = *app::g_pWindow;
-    Span2D sp = win.surfaceBuffer();
-
-    static int frame = 0;
-
-    for (isize y = 0; y < sp.getHeight(); ++y)
+    else
     {
-        for (isize x = 0; x < sp.getWidth(); ++x)
+        const gltf::Accessor& accIndices = gltfModel.m_vAccessors[primitive.indicesI];
+        switch (accIndices.eComponentType)
         {
-            ImagePixelRGBA pix;
-            pix.r = 255;
-            pix.g = static_cast<u8>(x);
-            pix.b = static_cast<u8>(x + frame);
-            pix.a = static_cast<u8>(y - frame);
+            default:
+            LOG_BAD("unsupported index type: {}\n", static_cast<int>(accIndices.eComponentType));
+            break;
 
-            sp(x, y).data = pix.data;
+            case gltf::COMPONENT_TYPE::UNSIGNED_BYTE:
+            clIndexed(gltfModel.accessorView<const u8>(primitive.indicesI));
+            break;
+
+            case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
+            clIndexed(gltfModel.accessorView<const u16>(primitive.indicesI));
+            break;
+
+            case gltf::COMPONENT_TYPE::UNSIGNED_INT:
+            clIndexed(gltfModel.accessorView<const u32>(primitive.indicesI));
+            break;
         }
     }
 
-    ++frame;
+    clFlush();
 }
 
+/* Triangles of BLEND primitives go to pVBlended, everything else to pVTriangles.
+ * Opaque primitives are also listed in pShadow if it's set, skinning is shared between the two views. */
 static void
-drawGLTFNode(Arena* pArena, gltf::Model& model, gltf::Node& node, math::M4 trm)
+drawNode(
+    Vec<Triangle>* pVTriangles, Vec<Triangle>* pVBlended, const ShadowCasters* pShadow, Arena* pArena,
+    const Model& model, const Model::Node& node, const math::M4& trm
+)
 {
     using namespace adt::math;
 
-    /* NOTE: must be one of asset::g_objects */
-    auto pObj = (const asset::Object*)&model;
+    const gltf::Node& gltfNode = model.gltfNode(node);
+    const auto& gltfModel = model.gltfModel();
 
-    common::updateModelNode(&model, &node, &trm);
+    for (const int& child : gltfNode.vChildren)
+        drawNode(pVTriangles, pVBlended, pShadow, pArena, model, model.m_vNodes[child], trm);
 
-    for (auto& children : node.vChildren)
-    {
-        auto& childNode = model.m_vNodes[children];
-        drawGLTFNode(pArena, model, childNode, trm);
-    }
+    if (gltfNode.meshI < 0) return;
 
-    if (node.meshI != NPOS)
-    {
-        auto& mesh = model.m_vMeshes[node.meshI];
-        for (const auto& primitive : mesh.vPrimitives)
-        {
-            /* TODO: can be NPOS */
-            ADT_ASSERT(primitive.indicesI != -1, " ");
-
-            auto& accIndices = model.m_vAccessors[primitive.indicesI];
-            auto& viewIndicies = model.m_vBufferViews[accIndices.bufferViewI];
-            auto& buffInd = model.m_vBuffers[viewIndicies.bufferI];
-
-            /* TODO: there might be any number of TEXCOORD_*,
-             * which would be specified in baseColorTexture.texCoord.
-             * But current gltf parser only reads the 0th. */
-            gltf::Accessor accUV {};
-            gltf::BufferView viewUV {};
-            gltf::Buffer buffUV {};
-            if (primitive.attributes.TEXCOORD_0 != -1)
-            {
-                accUV = model.m_vAccessors[primitive.attributes.TEXCOORD_0];
-                viewUV = model.m_vBufferViews[accUV.bufferViewI];
-                buffUV = model.m_vBuffers[viewUV.bufferI];
-            }
+    const M4 finalTrm = trm * node.finalTransform;
+    const M4 shadowTrm = pShadow ? pShadow->trm * node.finalTransform : M4 {};
+    const auto& gltfMesh = gltfModel.m_vMeshes[gltfNode.meshI];
 
-            auto& accPos = model.m_vAccessors[primitive.attributes.POSITION];
-            auto& viewPos = model.m_vBufferViews[accPos.bufferViewI];
-            auto& buffPos = model.m_vBuffers[viewPos.bufferI];
+    Span<i32> spBatch {pArena->mallocV<i32>(SETUP_BATCH_SIZE * 3), SETUP_BATCH_SIZE * 3};
+    Span<ProjectedTriangle> spProjected {pArena->mallocV<ProjectedTriangle>(SETUP_BATCH_SIZE), SETUP_BATCH_SIZE};
 
-            Span2D<ImagePixelRGBA> spImage = common::g_spDefaultTexture;
-            if (primitive.materialI != -1)
-            {
-                gltf::Material mat = model.m_vMaterials[primitive.materialI];
-                int baseTextureIdx = mat.pbrMetallicRoughness.baseColorTexture.index;
-                if (baseTextureIdx != static_cast<i32>(NPOS))
-                {
-                    auto& imgIdx = model.m_vTextures[baseTextureIdx].sourceI;
-                    auto& uri = model.m_vImages[imgIdx].sUri;
+    /* joint matrices already undo the node's own transform, same as in the gl skinning shader */
+    Span<View<const V3>> spSkinnedPos {};
+    if (gltfNode.skinI > -1)
+        spSkinnedPos = skinMesh(pArena, model, gltfNode);
 
-                    String nPath = file::replacePathEnding(pArena, pObj->m_sMappedWith, uri);
-                    Image* pImg = asset::searchImage(nPath);
+    for (const auto& primitive : gltfMesh.vPrimitives)
+    {
+        if (primitive.eMode != gltf::Primitive::TYPE::TRIANGLES) continue;
 
-                    if (pImg)
-                        spImage = pImg->getSpanRGBA();
-                }
-            }
+        const isize primitiveI = gltfMesh.vPrimitives.idx(&primitive);
+        const bool bSkinned = !spSkinnedPos.empty() && !spSkinnedPos[primitiveI].empty();
 
-            ADT_ASSERT(accIndices.eComponentType == gltf::COMPONENT_TYPE::UNSIGNED_SHORT ||
-                accIndices.eComponentType == gltf::COMPONENT_TYPE::UNSIGNED_INT,
-                "exp: {} or %d, got: {}",
-                (int)gltf::COMPONENT_TYPE::UNSIGNED_SHORT,
-                (int)gltf::COMPONENT_TYPE::UNSIGNED_INT,
-                (int)accIndices.eComponentType
-            );
+        const gltf::Material* pMaterial = primitive.materialI >= 0 ? &gltfModel.m_vMaterials[primitive.materialI] : nullptr;
+        const bool bBlend = pMaterial && pMaterial->eAlphaMode == gltf::Material::ALPHA_MODE::BLEND;
 
-            Span<V2> spUVs {};
-            if (primitive.attributes.TEXCOORD_0 != -1)
-            {
-                spUVs = {
-                    (V2*)&buffUV.sBin[accUV.byteOffset + viewUV.byteOffset],
-                    accUV.count
-                };
-            }
+        /* bind pose bounds don't hold for skinned positions */
+        V3 boundsMin, boundsMax;
+        const bool bBounds = !bSkinned && gltfModel.positionBounds(primitive, &boundsMin, &boundsMax);
+        const bool bVisible = !bBounds || !cpu::kernels().pfnBoxOffScreen(finalTrm, boundsMin, boundsMax);
+        /* culled against the fitted map in drawShadowMap() */
+        const bool bCastsShadow = pShadow && !bBlend;
 
-            ADT_ASSERT(accPos.eType == gltf::Accessor::TYPE::VEC3, " ");
-            const Span<V3> spPos {
-                (V3*)&buffPos.sBin[accPos.byteOffset + viewPos.byteOffset],
-                accPos.count
-            };
+        if (!bVisible && !bCastsShadow) continue;
 
-            switch (primitive.eMode)
-            {
-                default: break;
+        const View<const V3> vwPos = bSkinned ?
+            spSkinnedPos[primitiveI] : gltfModel.accessorView<const V3>(primitive.attributes.POSITION);
 
-                case gltf::Primitive::TYPE::TRIANGLES:
-                {
-                    if (accIndices.count < 3)
-                    {
-                        LOG_BAD("accIndices.count: {}\n", accIndices.count);
-                        return;
-                    }
+        if (bCastsShadow)
+            pShadow->pVCasters->push(pArena, {&gltfModel, &primitive, vwPos, shadowTrm, bSkinned});
 
-                    switch (accIndices.eComponentType)
-                    {
-                        default: break;
+        if (!bVisible) continue;
 
-                        case gltf::COMPONENT_TYPE::UNSIGNED_SHORT:
-                        {
-                            const Span<IndexU16x3> spIndiciesU16 {
-                                (IndexU16x3*)&buffInd.sBin[accIndices.byteOffset + viewIndicies.byteOffset],
-                                accIndices.count / 3
-                            };
+        const Image* pTexture = primitiveTexture(pArena, model, primitive);
 
-                            for (const auto [i0, i1, i2] : spIndiciesU16)
-                            {
-                                V3 aPos[3] {spPos[i0], spPos[i1], spPos[i2]};
-                                V2 aUVs[3] {};
-                                if (primitive.attributes.TEXCOORD_0 != -1)
-                                {
-                                    aUVs[0] = spUVs[i0];
-                                    aUVs[1] = spUVs[i1];
-                                    aUVs[2] = spUVs[i2];
-                                }
-
-                                drawTriangle(
-                                    trm*V4From(aPos[0], 1.0f), trm * V4From(aPos[1], 1.0f), trm* V4From(aPos[2], 1.0f),
-                                    aUVs[0], aUVs[1], aUVs[2],
-                                    spImage
-                                );
-                            }
-                        }
-                        break;
+        Vec<Triangle>* pVOut = bBlend ? pVBlended : pVTriangles;
+        const isize firstOutI = pVOut->size();
+        const ClipPositions clipPositions = transformPositions(pArena, finalTrm, vwPos, s_renderWidth, s_renderHeight);
 
-                        case gltf::COMPONENT_TYPE::UNSIGNED_INT:
-                        {
-                            const Span<IndexU32x3> spIndiciesU32 {
-                                (IndexU32x3*)&buffInd.sBin[accIndices.byteOffset + viewIndicies.byteOffset],
-                                accIndices.count / 3
-                            };
+        /* TODO: there might be any number of TEXCOORD_*,
+         * which would be specified in baseColorTexture.texCoord.
+         * But current gltf parser only reads the 0th. */
+        View<const V2> vwUVs {};
+        if (primitive.attributes.TEXCOORD_0 > -1)
+            vwUVs = gltfModel.accessorView<const V2>(primitive.attributes.TEXCOORD_0);
 
-                            for (const auto [i0, i1, i2] : spIndiciesU32)
-                            {
-                                V3 aPos[3] {spPos[i0], spPos[i1], spPos[i2]};
-                                V2 aUVs[3] {};
-                                if (primitive.attributes.TEXCOORD_0 != -1)
-                                {
-                                    aUVs[0] = spUVs[i0];
-                                    aUVs[1] = spUVs[i1];
-                                    aUVs[2] = spUVs[i2];
-                                }
-
-                                drawTriangle(
-                                    trm*V4From(aPos[0], 1.0f), trm*V4From(aPos[1], 1.0f), trm*V4From(aPos[2], 1.0f),
-                                    aUVs[0], aUVs[1], aUVs[2],
-                                    spImage
-                                );
-                            }
-                        }
-                        break;
-                    } /* switch (accIndices.componentType) */
-                }
-                break;
-            } /* switch (primitive.mode) */
+        drawPrimitive(
+            pVOut, pArena, gltfModel, primitive, vwPos.size(), clipPositions, vwUVs, pTexture,
+            s_renderWidth, s_renderHeight, spBatch, spProjected
+        );
+
+        if (bBlend)
+        {
+            const f32 factorAlpha = utils::clamp(pMaterial->pbrMetallicRoughness.baseColorFactor.a, 0.0f, 1.0f);
+            const u16 alpha = static_cast<u16>(std::round(factorAlpha * 256.0f));
+            for (isize i = firstOutI; i < pVOut->size(); ++i)
+                (*pVOut)[i].alpha = alpha;
         }
     }
 }
 
 static void
-drawGLTF(Arena* pArena, gltf::Model& model, math::M4 trm)
+drawModel(
+    Vec<Triangle>* pVTriangles, Vec<Triangle>* pVBlended, const ShadowCasters* pShadow, Arena* pArena,
+    const Model& model, const math::M4& trm
+)
 {
-    auto& scene = model.m_vScenes[model.m_defaultScene.nodeI];
-    for (auto& nodeI : scene.vNodes)
-        drawGLTFNode(pArena, model, model.m_vNodes[nodeI], trm);
+    const gltf::Model& gltfModel = model.gltfModel();
+    const gltf::Scene& scene = gltfModel.m_vScenes[gltfModel.m_defaultSceneI];
+
+    for (const int& nodeI : scene.vNodes)
+        drawNode(pVTriangles, pVBlended, pShadow, pArena, model, model.m_vNodes[nodeI], trm);
 }
 
-[[maybe_unused]] static void
-drawImgDBG(Image* pImg)
+/* Two passes: count triangles per tile, then scatter indices into prefix summed slots. */
+static Bins
+binTriangles(Arena* pArena, const Span<const Triangle> spTriangles, const int width, const int height)
 {
-    ADT_ASSERT(pImg, "pImg == nullptr");
+    Bins bins {};
+    bins.nTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    bins.nTilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    const isize nTiles = bins.nTilesX * bins.nTilesY;
 
-    auto& win = app::windowInst();
-    auto sp = win.surfaceBuffer();
-    auto spImg = pImg->getSpanRGBA();
+    bins.spOffsets = {pArena->zallocV<u32>(nTiles + 1), nTiles + 1};
+
+    for (const Triangle& tri : spTriangles)
+    {
+        for (int tileY = tri.bbox.minY / TILE_SIZE; tileY <= tri.bbox.maxY / TILE_SIZE; ++tileY)
+        {
+            for (int tileX = tri.bbox.minX / TILE_SIZE; tileX <= tri.bbox.maxX / TILE_SIZE; ++tileX)
+                ++bins.spOffsets[tileY*bins.nTilesX + tileX + 1];
+        }
+    }
 
-    const f32 xStep = static_cast<f32>(spImg.getWidth()) / static_cast<f32>(sp.getWidth());
-    const f32 yStep = static_cast<f32>(spImg.getHeight()) / static_cast<f32>(sp.getHeight());
+    for (isize i = 1; i <= nTiles; ++i)
+        bins.spOffsets[i] += bins.spOffsets[i - 1];
 
-    for (int y = 0; y < sp.getHeight(); ++y)
+    const isize nBinned = bins.spOffsets[nTiles];
+    bins.spTriangleIs = {pArena->mallocV<u32>(utils::max(nBinned, isize(1))), nBinned};
+
+    /* write cursor per tile, starts at the tile's offset */
+    Span<u32> spCursors {pArena->mallocV<u32>(nTiles), nTiles};
+    for (isize i = 0; i < nTiles; ++i)
+        spCursors[i] = bins.spOffsets[i];
+
+    for (isize triangleI = 0; triangleI < spTriangles.size(); ++triangleI)
     {
-        for (int x = 0; x < sp.getWidth(); ++x)
-            sp(x, y) = spImg(x * xStep, y * yStep);
+        const Rect& bbox = spTriangles[triangleI].bbox;
+        for (int tileY = bbox.minY / TILE_SIZE; tileY <= bbox.maxY / TILE_SIZE; ++tileY)
+        {
+            for (int tileX = bbox.minX / TILE_SIZE; tileX <= bbox.maxX / TILE_SIZE; ++tileX)
+                bins.spTriangleIs[spCursors[tileY*bins.nTilesX + tileX]++] = static_cast<u32>(triangleI);
+        }
     }
-}
 
-void
-Renderer::init()
-{
+    return bins;
 }
 
-void
-Renderer::drawEntities(Arena* pArena)
+struct RasterTilesArg
 {
-    using namespace adt::math;
+    const Triangle* pTriangles {};
+    const Bins* pBins {};
+    i32 clearColor {};
+    DEPTH_FORMAT eDepthFormat {};
+    RasterTarget target {};
+    PfnDrawTriangle pfnDrawTriangle {};
+    PfnShadeTile pfnShadeTile {}; /* visibility buffer resolve */
+    const Triangle* pBlended {}; /* BLEND primitives, composited over the finished opaque tile */
+    Bins* pBlendedBins {}; /* each tile sorts its own range */
+    const f32* pBlendedDepths {}; /* sort keys, summed vertex depths */
+    PfnDrawTriangle pfnDrawBlended {};
+    u8* pDrawnTiles {}; /* written per tile, see s_vDrawnTiles */
+    const ShadowMap* pShadowMap {}; /* null with g_bShadows off */
+    PfnShadowTile pfnShadowTile {};
+    atomic::Int atomNextTileI {};
+};
+
+/* Depth and hi-z part of clearTile(). */
+static void
+clearTileDepth(RasterTarget target, const Rect tile, const int groupWidth, const DEPTH_FORMAT eDepthFormat)
+{
+    for (int y = tile.minY; y <= tile.maxY; ++y)
+    {
+        switch (eDepthFormat)
+        {
+            case DEPTH_FORMAT::F32:
+            cpu::kernels().pfnFillF32({&target.spDepth(tile.minX, y), groupWidth}, std::numeric_limits<f32>::max());
+            break;
 
-    static Vec<f64> s_vFrameTimes(StdAllocatorInst(), 1000);
-    static f64 s_lastAvgFrameTimeUpdate {};
+            case DEPTH_FORMAT::UNORM16:
+            simd::i16Fillx8({reinterpret_cast<i16*>(&target.spDepth16(tile.minX, y)), groupWidth}, static_cast<i16>(UNORM16_DEPTH_MAX));
+            break;
 
-    const f64 t0 = utils::timeNowMS();
+            case DEPTH_FORMAT::UNORM24_STENCIL8:
+            cpu::kernels().pfnFillI32(
+                {reinterpret_cast<i32*>(&target.spDepthStencil(tile.minX, y)), groupWidth}, static_cast<i32>(UNORM24_DEPTH_MAX << 8)
+            );
+            break;
+        }
+    }
 
-    auto& win = app::windowInst();
+    const int hiZFirstX = tile.minX / HI_Z_BLOCK_SIZE;
+    const int hiZWidth = (groupWidth + HI_Z_BLOCK_SIZE - 1) / HI_Z_BLOCK_SIZE;
+    for (int y = tile.minY / HI_Z_BLOCK_SIZE; y <= tile.maxY / HI_Z_BLOCK_SIZE; ++y)
+        cpu::kernels().pfnFillF32({&target.spHiZ(hiZFirstX, y), hiZWidth}, std::numeric_limits<f32>::max());
+}
 
-    win.clearSurfaceBuffer({0.1f, 0.1f, 0.1f, 1.0f});
-    win.clearDepthBuffer();
+/* Puts the tile into its clear state right before its first triangle, while it is about to be in cache anyway.
+ * Whole row groups, the last tile in a row spills into the stride padding. */
+static void
+clearTile(RasterTarget target, const Rect tile, const int groupWidth, const i32 clearColor, const DEPTH_FORMAT eDepthFormat)
+{
+    for (int y = tile.minY; y <= tile.maxY; ++y)
+        cpu::kernels().pfnFillI32({&target.sp(tile.minX, y).iData, groupWidth}, clearColor);
+
+    clearTileDepth(target, tile, groupWidth, eDepthFormat);
+}
+
+/* Each tile is owned by exactly one thread at a time, so color and depth writes need no locking. */
+static THREAD_STATUS
+rasterTiles(void* pArg)
+{
+    auto& arg = *static_cast<RasterTilesArg*>(pArg);
+    const Bins& bins = *arg.pBins;
+    Bins& blendedBins = *arg.pBlendedBins;
+    const int nTiles = bins.nTilesX * bins.nTilesY;
+    const int width = static_cast<int>(arg.target.sp.width());
+    const int height = static_cast<int>(arg.target.sp.height());
+
+    int tileI;
+    while ((tileI = arg.atomNextTileI.fetchAdd(1, atomic::ORDER::RELAXED)) < nTiles)
+    {
+        const int tileX = tileI % bins.nTilesX;
+        const int tileY = tileI / bins.nTilesX;
+
+        const Rect tile {
+            .minX = tileX * TILE_SIZE,
+            .minY = tileY * TILE_SIZE,
+            .maxX = utils::min(tileX*TILE_SIZE + TILE_SIZE - 1, width - 1),
+            .maxY = utils::min(tileY*TILE_SIZE + TILE_SIZE - 1, height - 1),
+        };
+
+        /* whole row groups, the last tile in a row spills into the stride padding */
+        const int groupWidth = (tile.maxX - tile.minX + MAX_LANE_WIDTH) & ~(MAX_LANE_WIDTH - 1);
+
+        const u32 firstBlendedI = blendedBins.spOffsets[tileI];
+        const u32 endBlendedI = blendedBins.spOffsets[tileI + 1];
+
+        /* Nothing reads the depth of an empty tile, and its color goes straight to the presented buffer. */
+        if (bins.spOffsets[tileI] == bins.spOffsets[tileI + 1] && firstBlendedI == endBlendedI)
+        {
+            cpu::kernels().pfnStreamFillI32(
+                {&arg.target.sp(tile.minX, tile.minY).iData, groupWidth, tile.maxY - tile.minY + 1, arg.target.sp.stride()},
+                arg.clearColor
+            );
+            arg.pDrawnTiles[tileI] = false;
+            continue;
+        }
+
+        arg.pDrawnTiles[tileI] = true;
+
+        clearTile(arg.target, tile, groupWidth, arg.clearColor, arg.eDepthFormat);
+
+        const bool bVisibility = arg.target.spIDs.data() != nullptr;
+        if (bVisibility)
+        {
+            for (int y = tile.minY; y <= tile.maxY; ++y)
+                cpu::kernels().pfnFillI32({&arg.target.spIDs(tile.minX, y), groupWidth}, NO_TRIANGLE_I);
+        }
+
+        for (u32 i = bins.spOffsets[tileI]; i < bins.spOffsets[tileI + 1]; ++i)
+        {
+            const i32 triangleI = static_cast<i32>(bins.spTriangleIs[i]);
+            const Triangle& tri = arg.pTriangles[triangleI];
+            arg.pfnDrawTriangle(tri, triangleI, tile, arg.target);
+        }
+
+        if (bVisibility)
+            arg.pfnShadeTile(arg.pTriangles, tile, arg.target);
+
+        /* only opaque pixels look up their depth, blended ones get drawn over them unshadowed */
+        if (arg.pShadowMap)
+            arg.pfnShadowTile(*arg.pShadowMap, tile, arg.target);
+
+        if (firstBlendedI != endBlendedI)
+        {
+            /* back to front, ties keep the submission order */
+            const f32* pDepths = arg.pBlendedDepths;
+            sort::quick(blendedBins.spTriangleIs.data(), firstBlendedI, endBlendedI - 1,
+                [pDepths](const u32 l, const u32 r) -> int
+                {
+                    if (pDepths[l] != pDepths[r]) return pDepths[l] > pDepths[r] ? -1 : 1;
+                    return (l > r) - (l < r);
+                }
+            );
+
+            for (u32 i = firstBlendedI; i < endBlendedI; ++i)
+            {
+                const i32 triangleI = static_cast<i32>(blendedBins.spTriangleIs[i]);
+                arg.pfnDrawBlended(arg.pBlended[triangleI], triangleI, tile, arg.target);
+            }
+        }
+    }
+
+    return THREAD_STATUS(0);
+}
+
+struct ShadowTilesArg
+{
+    const Triangle* pTriangles {};
+    const Bins* pBins {};
+    RasterTarget target {}; /* F32 depth and hi-z only */
+    PfnDrawTriangle pfnDrawTriangle {}; /* PASS::DEPTH */
+    atomic::Int atomNextTileI {};
+};
+
+/* PASS::DEPTH version of rasterTiles(), empty tiles get cleared too since the shadow lookups read all of the map. */
+static THREAD_STATUS
+rasterShadowTiles(void* pArg)
+{
+    auto& arg = *static_cast<ShadowTilesArg*>(pArg);
+    const Bins& bins = *arg.pBins;
+    const int nTiles = bins.nTilesX * bins.nTilesY;
+
+    int tileI;
+    while ((tileI = arg.atomNextTileI.fetchAdd(1, atomic::ORDER::RELAXED)) < nTiles)
+    {
+        const int tileX = tileI % bins.nTilesX;
+        const int tileY = tileI / bins.nTilesX;
+
+        const Rect tile {
+            .minX = tileX * TILE_SIZE,
+            .minY = tileY * TILE_SIZE,
+            .maxX = tileX*TILE_SIZE + TILE_SIZE - 1,
+            .maxY = tileY*TILE_SIZE + TILE_SIZE - 1,
+        };
+
+        clearTileDepth(arg.target, tile, TILE_SIZE, DEPTH_FORMAT::F32);
+
+        for (u32 i = bins.spOffsets[tileI]; i < bins.spOffsets[tileI + 1]; ++i)
+        {
+            const i32 triangleI = static_cast<i32>(bins.spTriangleIs[i]);
+            arg.pfnDrawTriangle(arg.pTriangles[triangleI], triangleI, tile, arg.target);
+        }
+    }
+
+    return THREAD_STATUS(0);
+}
+
+/* Pushes the depth of every triangle away from the light by its slope per texel, like a polygon offset. */
+static void
+offsetShadowDepth(Span<Triangle> spTriangles, const f32 maxOffset)
+{
+    using namespace adt::math;
+
+    for (Triangle& tri : spTriangles)
+    {
+        const IV2 edge0 = tri.aPoints[1] - tri.aPoints[0];
+        const IV2 edge1 = tri.aPoints[2] - tri.aPoints[1];
+        const IV2 edge2 = tri.aPoints[0] - tri.aPoints[2];
+
+        /* same barycentric steps as in setupTriangle() */
+        const V3 tDX = V3{-(f32)edge1.y, -(f32)edge2.y, -(f32)edge0.y} * tri.barycentricDiv;
+        const V3 tDY = V3{(f32)edge1.x, (f32)edge2.x, (f32)edge0.x} * tri.barycentricDiv;
+        const V3 z {tri.aVertices[0].pos.z, tri.aVertices[1].pos.z, tri.aVertices[2].pos.z};
+
+        const f32 slope = utils::max(std::abs(V3Dot(tDX, z)), std::abs(V3Dot(tDY, z)));
+        const f32 offset = utils::min(slope * SHADOW_SLOPE_BIAS, maxOffset);
+
+        for (clip::Vertex& vertex : tri.aVertices)
+            vertex.pos.z += offset;
+    }
+}
+
+/* Light view space bounds of what the caster covers. */
+static void
+casterBounds(const ShadowCaster& caster, math::V3* pMin, math::V3* pMax)
+{
+    using namespace adt::math;
+
+    auto clPoint = [&](const V3 p)
+    {
+        const V3 v = (caster.trm * V4From(p, 1.0f)).xyz;
+        *pMin = {utils::min(pMin->x, v.x), utils::min(pMin->y, v.y), utils::min(pMin->z, v.z)};
+        *pMax = {utils::max(pMax->x, v.x), utils::max(pMax->y, v.y), utils::max(pMax->z, v.z)};
+    };
+
+    *pMin = V3{1.0f, 1.0f, 1.0f} * INFINITY;
+    *pMax = V3{1.0f, 1.0f, 1.0f} * -INFINITY;
+
+    /* bind pose bounds don't hold for skinned positions */
+    V3 boundsMin, boundsMax;
+    if (!caster.bSkinned && caster.pGltfModel->positionBounds(*caster.pPrimitive, &boundsMin, &boundsMax))
+    {
+        for (int cornerI = 0; cornerI < 8; ++cornerI)
+        {
+            clPoint({
+                cornerI & 1 ? boundsMax.x : boundsMin.x,
+                cornerI & 2 ? boundsMax.y : boundsMin.y,
+                cornerI & 4 ? boundsMax.z : boundsMin.z,
+            });
+        }
+    }
+    else
+    {
+        for (const V3& pos : caster.vwPos) clPoint(pos);
+    }
+}
+
+/* Light view space x, y bounds of the view frustum up to SHADOW_DISTANCE, the receivers that can show a shadow. */
+static void
+receiverBounds(const math::M4& trmLightView, const f32 aspectRatio, math::V2* pMin, math::V2* pMax)
+{
+    using namespace adt::math;
 
     const auto& camera = control::g_camera;
-    const f32 aspectRatio = static_cast<f32>(win.m_winWidth) / static_cast<f32>(win.m_winHeight);
+    const f32 tanHalfFov = std::tan(toRad(camera.m_fov) * 0.5f);
+
+    /* rows of the view matrix are the camera axes */
+    const M4& view = camera.m_view;
+    const V3 right {view.e[0][0], view.e[1][0], view.e[2][0]};
+    const V3 up {view.e[0][1], view.e[1][1], view.e[2][1]};
+    const V3 front {view.e[0][2], view.e[1][2], view.e[2][2]};
+
+    const V2 camPos = (trmLightView * V4From(camera.m_pos, 1.0f)).xy;
+    *pMin = *pMax = camPos;
+
+    const V3 farCenter = camera.m_pos + front*SHADOW_DISTANCE;
+    const V3 farUp = up * (SHADOW_DISTANCE * tanHalfFov);
+    const V3 farRight = right * (SHADOW_DISTANCE * tanHalfFov * aspectRatio);
+
+    for (int cornerI = 0; cornerI < 4; ++cornerI)
+    {
+        const V3 corner = farCenter + (cornerI & 1 ? farRight : -farRight) + (cornerI & 2 ? farUp : -farUp);
+        const V2 v = (trmLightView * V4From(corner, 1.0f)).xy;
+        *pMin = {utils::min(pMin->x, v.x), utils::min(pMin->y, v.y)};
+        *pMax = {utils::max(pMax->x, v.x), utils::max(pMax->y, v.y)};
+    }
+}
+
+/* PASS::DEPTH raster of the light space triangles into s_vShadowDepth on the thread pool. */
+static void
+rasterShadowMap(Arena* pArena, const Span<const Triangle> spTriangles, const int mapSize)
+{
+    const int hiZSize = mapSize / HI_Z_BLOCK_SIZE;
+
+    s_vShadowDepth.setSize(StdAllocator::inst(), mapSize * mapSize);
+    s_vShadowHiZ.setSize(StdAllocator::inst(), hiZSize * hiZSize);
+
+    const Bins bins = binTriangles(pArena, spTriangles, mapSize, mapSize);
+
+    ShadowTilesArg arg {
+        .pTriangles = spTriangles.data(),
+        .pBins = &bins,
+        .target {
+            .spDepth {s_vShadowDepth.data(), mapSize, mapSize, mapSize},
+            .spHiZ {s_vShadowHiZ.data(), hiZSize, hiZSize, hiZSize},
+        },
+        .pfnDrawTriangle = kernels().pfnSelectDrawTriangle({.ePass = PASS::DEPTH, .eDepthFormat = DEPTH_FORMAT::F32}),
+    };
+
+    const int nHelpers = utils::min(app::g_threadPool.nThreads(), bins.nTilesX*bins.nTilesY - 1);
+    for (int i = 0; i < nHelpers; ++i)
+        app::g_threadPool.addRetry(rasterShadowTiles, &arg);
+
+    rasterShadowTiles(&arg);
+    app::g_threadPool.wait();
+}
+
+/* Fits an orthographic projection to the casters over the receiver rect and rasterizes them, unless the projection,
+ * map size and every caster are the same as last time. False if no caster can shadow anything visible.
+ * *pTrmViewProj is the light view projection, *pTexelDepth the light depth of a map texel. */
+static bool
+drawShadowMap(
+    Arena* pArena, const Span<const ShadowCaster> spCasters, const math::M4& trmLightView, const f32 aspectRatio,
+    Span2D<const f32>* pSpDepth, math::M4* pTrmViewProj, f32* pTexelDepth
+)
+{
+    using namespace adt::math;
+
+    V2 receiverMin, receiverMax;
+    receiverBounds(trmLightView, aspectRatio, &receiverMin, &receiverMax);
+
+    /* only the casters over the receivers */
+    Span<u8> spIncluded {pArena->zallocV<u8>(utils::max(spCasters.size(), isize(1))), spCasters.size()};
+    V3 min = V3{1.0f, 1.0f, 1.0f} * INFINITY;
+    V3 max = V3{1.0f, 1.0f, 1.0f} * -INFINITY;
+    for (isize i = 0; i < spCasters.size(); ++i)
+    {
+        V3 casterMin, casterMax;
+        casterBounds(spCasters[i], &casterMin, &casterMax);
+
+        if (casterMax.x < receiverMin.x || casterMin.x > receiverMax.x ||
+            casterMax.y < receiverMin.y || casterMin.y > receiverMax.y
+        )
+        {
+            continue;
+        }
+
+        spIncluded[i] = true;
+        min = {utils::min(min.x, casterMin.x), utils::min(min.y, casterMin.y), utils::min(min.z, casterMin.z)};
+        max = {utils::max(max.x, casterMax.x), utils::max(max.y, casterMax.y), utils::max(max.z, casterMax.z)};
+    }
+
+    if (!(min.x <= max.x)) return false;
+
+    min.x = utils::max(min.x, receiverMin.x);
+    min.y = utils::max(min.y, receiverMin.y);
+    max.x = utils::min(max.x, receiverMax.x);
+    max.y = utils::min(max.y, receiverMax.y);
+
+    /* square rect and depth range on a power of two grid */
+    const f32 extent = utils::max(utils::max(max.x - min.x, max.y - min.y), max.z - min.z);
+    const f32 step = std::exp2(std::ceil(std::log2(utils::max(extent, 0.001f) / SHADOW_SNAP_STEPS)));
+    const V3 origin = V3{std::floor(min.x / step), std::floor(min.y / step), std::floor(min.z / step)} * step;
+    const f32 side = std::ceil(utils::max(max.x - origin.x, max.y - origin.y) / step) * step;
+    const f32 depthRange = utils::max(std::ceil((max.z - origin.z) / step), 1.0f) * step;
+
+    /* Same handedness as the camera, so the back face test keeps the same faces, depth goes from 0 to 1 over depthRange. */
+    const M4 proj {
+        2.0f / side,                    0.0f,                           0.0f,                       0.0f,
+        0.0f,                           2.0f / side,                    0.0f,                       0.0f,
+        0.0f,                           0.0f,                           1.0f / depthRange,          0.0f,
+        -2.0f*origin.x/side - 1.0f,     -2.0f*origin.y/side - 1.0f,     -origin.z / depthRange,     1.0f,
+    };
+
+    const int largerAxis = utils::max(s_renderWidth, s_renderHeight);
+    const int mapSize = utils::clamp((largerAxis + TILE_SIZE - 1) & ~(TILE_SIZE - 1), MIN_SHADOW_MAP_SIZE, MAX_SHADOW_MAP_SIZE);
+
+    *pTrmViewProj = proj * trmLightView;
+    *pTexelDepth = side / static_cast<f32>(mapSize) / depthRange;
+
+    usize hash = hash::func(pTrmViewProj, sizeof(*pTrmViewProj), mapSize);
+    for (isize i = 0; i < spCasters.size(); ++i)
+    {
+        if (!spIncluded[i]) continue;
+
+        const ShadowCaster& caster = spCasters[i];
+        hash = hash::func(&caster.pPrimitive, sizeof(caster.pPrimitive), hash);
+        hash = hash::func(&caster.trm, sizeof(caster.trm), hash);
+        /* skinned positions are packed */
+        if (caster.bSkinned && !caster.vwPos.empty())
+            hash = hash::func(&caster.vwPos[0], caster.vwPos.size() * caster.vwPos.stride(), hash);
+    }
+
+    *pSpDepth = {s_vShadowDepth.data(), mapSize, mapSize, mapSize};
+    if (hash == s_shadowHash && mapSize == s_shadowMapSize) return true;
+
+    Vec<Triangle>& vTriangles = s_vShadowTriangles;
+    vTriangles.setSize(StdAllocator::inst(), 0);
+    {
+        Span<i32> spBatch {pArena->mallocV<i32>(SETUP_BATCH_SIZE * 3), SETUP_BATCH_SIZE * 3};
+        Span<ProjectedTriangle> spProjected {pArena->mallocV<ProjectedTriangle>(SETUP_BATCH_SIZE), SETUP_BATCH_SIZE};
+
+        for (isize i = 0; i < spCasters.size(); ++i)
+        {
+            if (!spIncluded[i]) continue;
+
+            const ShadowCaster& caster = spCasters[i];
+            const ClipPositions clipPositions = transformPositions(pArena, proj * caster.trm, caster.vwPos, mapSize, mapSize);
+            drawPrimitive(
+                &vTriangles, StdAllocator::inst(), *caster.pGltfModel, *caster.pPrimitive, caster.vwPos.size(), clipPositions, {}, nullptr,
+                mapSize, mapSize, spBatch, spProjected
+            );
+        }
+    }
+
+    offsetShadowDepth({vTriangles.data(), vTriangles.size()}, *pTexelDepth * SHADOW_MAX_SLOPE_BIAS);
+    rasterShadowMap(pArena, {vTriangles.data(), vTriangles.size()}, mapSize);
+
+    s_shadowHash = hash;
+    s_shadowMapSize = mapSize;
+    *pSpDepth = {s_vShadowDepth.data(), mapSize, mapSize, mapSize};
+
+    return true;
+}
+
+/* View of a directional light at lightPos that shines towards the origin, z is the distance along the light. */
+static math::M4
+lightView(const math::V3 lightPos)
+{
+    using namespace adt::math;
+
+    const V3 front = V3Norm(-lightPos);
+    const V3 worldUp = std::abs(front.y) < 0.99f ? V3{0.0f, 1.0f, 0.0f} : V3{0.0f, 0.0f, 1.0f};
+    const V3 right = V3Norm(V3Cross(worldUp, front));
+    const V3 up = V3Cross(front, right);
+
+    return M4LookAt(right, up, front, lightPos);
+}
+
+/* One model with an outline. */
+struct Outline
+{
+    Rect rect {}; /* screen rect of its triangles */
+    math::V4 color {};
+    u8 stencil {};
+};
+
+/* Ring of OUTLINE_WIDTH pixels around the visible pixels of outline.stencil, like the stencil outline of the gl renderer.
+ * Separable square dilation of the stencil, limited to the screen rect of the outlined triangles. */
+static void
+drawOutline(Arena* pArena, RasterTarget target, const Bins& bins, const Outline& outline)
+{
+    const Rect& outlined = outline.rect;
+    const math::V4 color = outline.color;
+    const Rect rect {
+        .minX = utils::max(outlined.minX - OUTLINE_WIDTH, 0),
+        .minY = utils::max(outlined.minY - OUTLINE_WIDTH, 0),
+        .maxX = utils::min(outlined.maxX + OUTLINE_WIDTH, static_cast<int>(target.sp.width()) - 1),
+        .maxY = utils::min(outlined.maxY + OUTLINE_WIDTH, static_cast<int>(target.sp.height()) - 1),
+    };
+    const int width = rect.maxX - rect.minX + 1;
+    const int height = rect.maxY - rect.minY + 1;
+
+    Span2D<u8> spStencil {pArena->mallocV<u8>(width * height), width, height, width};
+    Span2D<u8> spDilatedX {pArena->mallocV<u8>(width * height), width, height, width};
+
+    for (int y = 0; y < height; ++y)
+    {
+        const int tileRowI = ((rect.minY + y) / TILE_SIZE) * bins.nTilesX;
+        for (int x = 0; x < width; ++x)
+        {
+            /* tiles with nothing binned skipped their depth clear, their stencil is from some older frame */
+            const int tileI = tileRowI + (rect.minX + x) / TILE_SIZE;
+            const bool bCleared = bins.spOffsets[tileI] != bins.spOffsets[tileI + 1];
+            spStencil(x, y) = bCleared && (target.spDepthStencil(rect.minX + x, rect.minY + y) & 0xff) == outline.stencil;
+        }
+    }
+
+    /* running count of stencil pixels in [i - OUTLINE_WIDTH, i + OUTLINE_WIDTH] */
+    auto clDilate = [](auto clAt, const int size, auto clWrite)
+    {
+        int n = 0;
+        for (int i = 0; i < utils::min(OUTLINE_WIDTH, size); ++i) n += clAt(i);
+
+        for (int i = 0; i < size; ++i)
+        {
+            if (i + OUTLINE_WIDTH < size) n += clAt(i + OUTLINE_WIDTH);
+            if (i - OUTLINE_WIDTH - 1 >= 0) n -= clAt(i - OUTLINE_WIDTH - 1);
+            clWrite(i, n > 0);
+        }
+    };
+
+    for (int y = 0; y < height; ++y)
+    {
+        clDilate(
+            [&](const int x) { return static_cast<int>(spStencil(x, y)); }, width,
+            [&](const int x, const bool b) { spDilatedX(x, y) = b; }
+        );
+    }
+
+    ImagePixelRGBA outlineColor {.data = colors::V4ToRGBA(color)};
+    const int weight = static_cast<int>(utils::clamp(color.a, 0.0f, 1.0f) * 256.0f);
+    auto clBlend = [weight](const u8 dst, const u8 src) {
+        return static_cast<u8>((dst*(256 - weight) + src*weight) >> 8);
+    };
+
+    for (int x = 0; x < width; ++x)
+    {
+        clDilate(
+            [&](const int y) { return static_cast<int>(spDilatedX(x, y)); }, height,
+            [&](const int y, const bool b)
+            {
+                if (!b || spStencil(x, y)) return;
+
+                ImagePixelRGBA& pix = target.sp(rect.minX + x, rect.minY + y);
+                pix.r = clBlend(pix.r, outlineColor.r);
+                pix.g = clBlend(pix.g, outlineColor.g);
+                pix.b = clBlend(pix.b, outlineColor.b);
+            }
+        );
+    }
+}
+
+struct BlitChunkArg
+{
+    Span2D<ImagePixelRGBA> spDst {};
+    Span2D<const ImagePixelRGBA> spSrc {};
+    int firstY {};
+    int endY {};
+};
+
+static THREAD_STATUS
+blitChunk(void* pArg)
+{
+    const auto& arg = *static_cast<BlitChunkArg*>(pArg);
+    kernels().pfnBlitBilinear(arg.spDst, arg.spSrc, arg.firstY, arg.endY);
+
+    return THREAD_STATUS(0);
+}
+
+/* Upscales the scaled color target over the whole surface, in row chunks on the thread pool. */
+static void
+upscale(Arena* pArena, Span2D<ImagePixelRGBA> spDst, const Span2D<const ImagePixelRGBA> spSrc)
+{
+    for (int firstY = 0; firstY < spDst.height(); firstY += BLIT_CHUNK_HEIGHT)
+    {
+        auto* pArg = pArena->alloc<BlitChunkArg>(BlitChunkArg {
+            .spDst = spDst,
+            .spSrc = spSrc,
+            .firstY = firstY,
+            .endY = utils::min(firstY + BLIT_CHUNK_HEIGHT, static_cast<int>(spDst.height())),
+        });
+
+        app::g_threadPool.addRetry(blitChunk, pArg);
+    }
+
+    app::g_threadPool.wait();
+}
+
+/* Steers s_renderScale so that draw() takes about g_frameBudgetMS.
+ * The scale is per axis, so the per pixel part of the cost goes with its square. */
+static void
+updateRenderScale(const f32 drawTimeMS)
+{
+    if (g_frameBudgetMS <= 0.0f)
+    {
+        s_renderScale = 1.0f;
+        return;
+    }
+
+    /* moving average, a single slow frame doesn't drop the resolution */
+    s_avgDrawTimeMS = s_avgDrawTimeMS > 0.0f ? s_avgDrawTimeMS + (drawTimeMS - s_avgDrawTimeMS) * 0.125f : drawTimeMS;
+
+    /* dead band around the budget, and scaling back up only with some headroom, so it doesn't oscillate */
+    const f32 ratio = g_frameBudgetMS / utils::max(s_avgDrawTimeMS, 0.001f);
+    if (ratio > 0.95f && ratio < 1.25f) return;
+
+    const f32 newScale = utils::clamp(s_renderScale * utils::clamp(std::sqrt(ratio), 0.9f, 1.05f), MIN_RENDER_SCALE, 1.0f);
+    if (newScale == s_renderScale) return;
+
+    /* predict the average at the new scale, otherwise the lagging average keeps stepping past the budget */
+    const f32 step = newScale / s_renderScale;
+    s_avgDrawTimeMS *= step * step;
+    s_renderScale = newScale;
+}
+
+f32
+renderScale()
+{
+    return s_renderScale;
+}
+
+[[maybe_unused]] static void
+drawImgDBG(Image* pImg)
+{
+    ADT_ASSERT(pImg, "pImg == nullptr");
+
+    auto& win = app::windowInst();
+    auto sp = win.surfaceBuffer();
+    auto spImg = pImg->spanRGBA();
+
+    const f32 xStep = static_cast<f32>(spImg.width()) / static_cast<f32>(sp.width());
+    const f32 yStep = static_cast<f32>(spImg.height()) / static_cast<f32>(sp.height());
+
+    for (int y = 0; y < sp.height(); ++y)
+    {
+        for (int x = 0; x < sp.width(); ++x)
+            sp(x, y) = spImg(x * xStep, y * yStep);
+    }
+}
+
+const char*
+depthFormatName(const DEPTH_FORMAT eFormat)
+{
+    switch (eFormat)
+    {
+        case DEPTH_FORMAT::F32: return "f32";
+        case DEPTH_FORMAT::UNORM16: return "unorm16";
+        case DEPTH_FORMAT::UNORM24_STENCIL8: return "unorm24s8";
+    }
+
+    return "unknown";
+}
+
+void
+Renderer::init()
+{
+    switch (cpu::g_eISA)
+    {
+        case cpu::ISA::SSE4_2: g_pKernels = &g_kernelsSSE4_2; break;
+        case cpu::ISA::AVX2: g_pKernels = &g_kernelsAVX2; break;
+        case cpu::ISA::AVX512: g_pKernels = &g_kernelsAVX512; break;
+    }
+
+    LOG_GOOD("raster kernels: {}, {} lanes\n", cpu::ISAName(cpu::g_eISA), kernels().laneWidth);
+
+    ui::init();
+}
+
+/* Flags the tiles that rect touches as drawn, clipped to the render rect. */
+static void
+markDrawnTiles(Span<u8> spDrawnTiles, const Bins& bins, const Rect rect)
+{
+    const int minX = utils::max(rect.minX, 0) / TILE_SIZE;
+    const int minY = utils::max(rect.minY, 0) / TILE_SIZE;
+    const int maxX = utils::min(rect.maxX, s_renderWidth - 1) / TILE_SIZE;
+    const int maxY = utils::min(rect.maxY, s_renderHeight - 1) / TILE_SIZE;
+
+    for (int tileY = minY; tileY <= maxY; ++tileY)
+    {
+        for (int tileX = minX; tileX <= maxX; ++tileX)
+            spDrawnTiles[tileY*bins.nTilesX + tileX] = true;
+    }
+}
+
+/* FXAA pulls drawn pixels into the edge of the neighbouring tiles. */
+static Span<u8>
+dilateDrawnTiles(Arena* pArena, const Span<const u8> spDrawnTiles, const Bins& bins)
+{
+    Span<u8> spRes {pArena->zallocV<u8>(spDrawnTiles.size()), spDrawnTiles.size()};
 
+    for (int tileY = 0; tileY < bins.nTilesY; ++tileY)
     {
-        for (int entityI = 0; entityI < game::g_poolEntites.m_size; ++entityI)
+        for (int tileX = 0; tileX < bins.nTilesX; ++tileX)
         {
-            const auto& arrays = game::g_poolEntites.m_arrays;
-            if (arrays.abDead[entityI] || arrays.priv.abFree[entityI])
+            if (!spDrawnTiles[tileY*bins.nTilesX + tileX]) continue;
+
+            for (int y = utils::max(tileY - 1, 0); y <= utils::min(tileY + 1, bins.nTilesY - 1); ++y)
+            {
+                for (int x = utils::max(tileX - 1, 0); x <= utils::min(tileX + 1, bins.nTilesX - 1); ++x)
+                    spRes[y*bins.nTilesX + x] = true;
+            }
+        }
+    }
+
+    return spRes;
+}
+
+/* Hands the window every tile drawn this frame or the last one, one rect per run of tiles in a tile row. */
+static void
+reportDamage(IWindow* pWin, const Span<const u8> spDrawnTiles, const Bins& bins, const bool bPostProcess)
+{
+    const bool bFull = s_damageWidth != s_renderWidth || s_damageHeight != s_renderHeight ||
+        s_bDamagePostProcess != bPostProcess;
+
+    auto clDamaged = [&](const int tileI) {
+        return bFull || spDrawnTiles[tileI] || s_vDrawnTiles[tileI];
+    };
+
+    for (int tileY = 0; tileY < bins.nTilesY; ++tileY)
+    {
+        const int minY = tileY * TILE_SIZE;
+        const int height = utils::min(TILE_SIZE, s_renderHeight - minY);
+
+        int tileX = 0;
+        while (tileX < bins.nTilesX)
+        {
+            if (!clDamaged(tileY*bins.nTilesX + tileX))
+            {
+                ++tileX;
                 continue;
+            }
 
-            game::EntityBind entity = game::g_aEntites[ game::Entity{.i = entityI} ];
+            const int firstTileX = tileX;
+            while (tileX < bins.nTilesX && clDamaged(tileY*bins.nTilesX + tileX)) ++tileX;
 
-            M4 trm = M4Pers(toRad(camera.m_fov), aspectRatio, 0.01f, 1000.0f) *
-                camera.m_trm *
-                M4TranslationFrom(entity.pos) *
-                QtRot(entity.rot) *
-                M4ScaleFrom(entity.scale);
+            const int minX = firstTileX * TILE_SIZE;
+            pWin->damageRect(minX, minY, utils::min(tileX*TILE_SIZE, s_renderWidth) - minX, height);
+        }
+    }
 
-            auto& obj = asset::g_poolObjects[entity.assetI];
-            switch (obj.m_eType)
+    s_vDrawnTiles.setSize(StdAllocator::inst(), spDrawnTiles.size());
+    utils::memCopy(s_vDrawnTiles.data(), spDrawnTiles.data(), spDrawnTiles.size());
+    s_damageWidth = s_renderWidth;
+    s_damageHeight = s_renderHeight;
+    s_bDamagePostProcess = bPostProcess;
+}
+
+void
+Renderer::draw(Arena* pArena)
+{
+    using namespace adt::math;
+
+    const f64 timer0 = utils::timeNowMS();
+
+    auto& win = app::windowInst();
+
+    /* Past MAX_RASTER_EXTENT on-screen triangles alone would overflow the edge functions,
+     * such windows render at a smaller size and get scaled up like any other scaled frame. */
+    const f32 extentScale = utils::min(
+        static_cast<f32>(MAX_RASTER_EXTENT) / static_cast<f32>(utils::max(win.m_width, win.m_height)), 1.0f
+    );
+    const f32 scale = s_renderScale * extentScale;
+    s_renderWidth = utils::clamp(static_cast<int>(static_cast<f32>(win.m_width) * scale), 1, MAX_RASTER_EXTENT);
+    s_renderHeight = utils::clamp(static_cast<int>(static_cast<f32>(win.m_height) * scale), 1, MAX_RASTER_EXTENT);
+
+    /* Scaled frames go to the window as they are if it can stretch them (wayland viewport),
+     * otherwise into s_vScaledColor and get upscaled at the end. */
+    const bool bScaled = s_renderWidth != win.m_width || s_renderHeight != win.m_height;
+    const bool bUpscale = !win.presentRect(s_renderWidth, s_renderHeight) && bScaled;
+
+    /* where the finished render sized frame goes */
+    Span2D<ImagePixelRGBA> spPresent = win.surfaceBuffer();
+    if (bUpscale)
+    {
+        s_vScaledColor.setSize(StdAllocator::inst(), win.m_stride * s_renderHeight);
+        spPresent = {s_vScaledColor.data(), s_renderWidth, s_renderHeight, win.m_stride};
+    }
+
+    const bool bPostProcess = g_bPostProcess;
+    Span2D<ImagePixelRGBA> spColor = spPresent;
+    if (bPostProcess)
+    {
+        s_vPostColor.setSize(StdAllocator::inst(), win.m_stride * s_renderHeight);
+        spColor = {s_vPostColor.data(), s_renderWidth, s_renderHeight, win.m_stride};
+    }
+
+    /* window sized buffers, same stride */
+    auto clRenderRect = [&]<typename T>(Span2D<T> sp) -> Span2D<T> {
+        return {sp.data(), s_renderWidth, s_renderHeight, sp.stride()};
+    };
+
+    /* no full-screen clears, every tile clears itself in rasterTiles() */
+    const i32 clearColor = static_cast<i32>(colors::V4ToRGBA({0.1f, 0.1f, 0.1f, 1.0f}));
+
+    if (!control::g_bPauseSimulation)
+    {
+        for (auto& model : Model::g_poolModels)
+        {
+            app::g_threadPool.addRetry(+[](void* p) -> THREAD_STATUS
+                {
+                    auto* pModel = static_cast<Model*>(p);
+                    pModel->updateAnimation(pModel->m_time + frame::g_frameTime);
+                    return THREAD_STATUS(0);
+                }, &model
+            );
+        }
+
+        app::g_threadPool.wait();
+    }
+
+    const auto& camera = control::g_camera;
+    const f32 aspectRatio = static_cast<f32>(win.m_winWidth) / static_cast<f32>(win.m_winHeight);
+    const M4 trmProj = M4Pers(toRad(camera.m_fov), aspectRatio, 0.01f, 1000.0f);
+    const M4 trmViewProj = trmProj * camera.m_trm;
+
+    Vec<Triangle> vTriangles {};
+    Vec<Triangle> vBlended {};
+
+    /* opaque primitives in light view space */
+    bool bShadows = g_bShadows && g_eDepthFormat != DEPTH_FORMAT::UNORM16 &&
+        game::g_dirLight < game::g_vEntities.size() && V3Length(game::g_vEntities[game::g_dirLight].pos) > 0.0f;
+    const M4 trmLightView = bShadows ? lightView(game::g_vEntities[game::g_dirLight].pos) : M4 {};
+    Vec<ShadowCaster> vShadowCasters {};
+
+    /* models that get an outline, each with its own stencil value, only with a stencil plane */
+    const bool bStencil = g_eDepthFormat == DEPTH_FORMAT::UNORM24_STENCIL8;
+    Vec<Outline> vOutlines {};
+
+    {
+        auto& entities = game::g_vEntities;
+
+        if (entities.size() > 0)
+        {
+            game::Entity::Bind bind0 = entities[0];
+
+            for (int entityI = 0; entityI < entities.size(); ++entityI)
             {
-                default: break;
+                if ((&bind0.bNoDraw)[entityI]) continue;
+
+                auto& obj = asset::g_poolObjects[ {(&bind0.assetI)[entityI]} ];
 
-                case asset::Object::TYPE::MODEL:
+                switch (obj.m_eType)
                 {
-                    drawGLTF(pArena, obj.m_uData.model, trm);
+                    default: break;
+
+                    case asset::Object::TYPE::MODEL:
+                    {
+                        const Model& model = Model::fromI((&bind0.modelI)[entityI]);
+                        const isize firstTriangleI = vTriangles.size();
+                        const M4 trm = transformation(
+                            (&bind0.pos)[entityI],
+                            (&bind0.rot)[entityI],
+                            (&bind0.scale)[entityI]
+                        );
+
+                        /* the light's own model would shadow everything in line with it */
+                        const ShadowCasters shadow {.pVCasters = &vShadowCasters, .trm = trmLightView * trm};
+                        const bool bCastsShadow = bShadows && (&bind0.eType)[entityI] != game::ENTITY_TYPE::LIGHT;
+
+                        drawModel(&vTriangles, &vBlended, bCastsShadow ? &shadow : nullptr, pArena, model, trmViewProj * trm);
+
+                        /* past the last stencil value the rest go without */
+                        if (bStencil && model.m_oOutlineColor && FIRST_OUTLINE_STENCIL + vOutlines.size() <= 0xff)
+                        {
+                            Outline outline {
+                                .rect {.minX = s_renderWidth, .minY = s_renderHeight, .maxX = -1, .maxY = -1},
+                                .color = model.m_oOutlineColor.valueOr({}),
+                                .stencil = static_cast<u8>(FIRST_OUTLINE_STENCIL + vOutlines.size()),
+                            };
+
+                            for (isize i = firstTriangleI; i < vTriangles.size(); ++i)
+                            {
+                                Triangle& tri = vTriangles[i];
+                                tri.stencil = outline.stencil;
+                                outline.rect.minX = utils::min(outline.rect.minX, tri.bbox.minX);
+                                outline.rect.minY = utils::min(outline.rect.minY, tri.bbox.minY);
+                                outline.rect.maxX = utils::max(outline.rect.maxX, tri.bbox.maxX);
+                                outline.rect.maxY = utils::max(outline.rect.maxY, tri.bbox.maxY);
+                            }
+
+                            if (outline.rect.minX <= outline.rect.maxX)
+                                vOutlines.push(pArena, outline);
+                        }
+                    }
+                    break;
                 }
-                break;
             }
         }
     }
 
-    const f64 t1 = utils::timeNowMS();
-    s_vFrameTimes.push(t1 - t0);
+    const Bins bins = binTriangles(pArena, {vTriangles.data(), vTriangles.size()}, s_renderWidth, s_renderHeight);
+    Bins blendedBins = binTriangles(pArena, {vBlended.data(), vBlended.size()}, s_renderWidth, s_renderHeight);
 
-    if (t1 > s_lastAvgFrameTimeUpdate + 1000.0)
+    Span<f32> spBlendedDepths {pArena->mallocV<f32>(utils::max(vBlended.size(), isize(1))), vBlended.size()};
+    for (isize i = 0; i < vBlended.size(); ++i)
     {
-        f64 avg = 0;
-        for (f64 ft : s_vFrameTimes) avg += ft;
-        CERR("FPS: {} | avg frame time: {} ms\n", s_vFrameTimes.size(), avg / s_vFrameTimes.size());
-        s_vFrameTimes.setSize(0);
-        s_lastAvgFrameTimeUpdate = t1;
+        const Triangle& tri = vBlended[i];
+        spBlendedDepths[i] = tri.aVertices[0].pos.z + tri.aVertices[1].pos.z + tri.aVertices[2].pos.z;
     }
+
+    ShadowMap shadowMap {};
+    Span2D<const f32> spShadowDepth {};
+    M4 trmLightViewProj {};
+    f32 shadowTexelDepth = 0.0f;
+    if (bShadows)
+    {
+        bShadows = drawShadowMap(
+            pArena, {vShadowCasters.data(), vShadowCasters.size()}, trmLightView, aspectRatio,
+            &spShadowDepth, &trmLightViewProj, &shadowTexelDepth
+        );
+    }
+
+    if (bShadows)
+    {
+        /* render target pixels back to world space through the inverse camera, then into the map */
+        const f32 halfMapSize = static_cast<f32>(spShadowDepth.width()) * 0.5f;
+        const M4 trmNdcToMap {
+            halfMapSize, 0.0f,        0.0f, 0.0f,
+            0.0f,        halfMapSize, 0.0f, 0.0f,
+            0.0f,        0.0f,        1.0f, 0.0f,
+            halfMapSize, halfMapSize, 0.0f, 1.0f,
+        };
+        const M4 trmPixToNdc {
+            2.0f / static_cast<f32>(s_renderWidth), 0.0f,                                    0.0f, 0.0f,
+            0.0f,                                    2.0f / static_cast<f32>(s_renderHeight), 0.0f, 0.0f,
+            0.0f,                                    0.0f,                                    1.0f, 0.0f,
+            -1.0f,                                   -1.0f,                                   0.0f, 1.0f,
+        };
+
+        const V3 ambient = game::g_ambientLight;
+        shadowMap = {
+            .spDepth = spShadowDepth,
+            .trmPixToMap = trmNdcToMap * trmLightViewProj * M4Inv(camera.m_trm) * M4Inv(trmProj) * trmPixToNdc,
+            .bias = shadowTexelDepth * SHADOW_CONSTANT_BIAS,
+            .shadowWeight = static_cast<i32>(utils::clamp((ambient.x + ambient.y + ambient.z) / 3.0f, 0.0f, 1.0f) * 256.0f),
+        };
+    }
+
+    const RasterState state {
+        .eSampler = g_bTrilinearFiltering ? SAMPLER::TRILINEAR : SAMPLER::BILINEAR,
+        .eDepth = DEPTH::TEST_WRITE,
+        .eBlend = BLEND::NONE,
+        .ePass = g_bVisibilityBuffer ? PASS::VISIBILITY : PASS::SHADE,
+        .eDepthFormat = g_eDepthFormat,
+    };
+
+    RasterTilesArg arg {
+        .pTriangles = vTriangles.data(),
+        .pBins = &bins,
+        .clearColor = clearColor,
+        .eDepthFormat = state.eDepthFormat,
+        .target {
+            .sp = clRenderRect(spColor),
+            .spDepth = state.eDepthFormat == DEPTH_FORMAT::F32 ? clRenderRect(win.depthBuffer()) : Span2D<f32> {},
+            .spDepth16 = state.eDepthFormat == DEPTH_FORMAT::UNORM16 ? clRenderRect(win.depthBuffer16()) : Span2D<u16> {},
+            .spDepthStencil = state.eDepthFormat == DEPTH_FORMAT::UNORM24_STENCIL8 ? clRenderRect(win.depthStencilBuffer()) : Span2D<u32> {},
+            .spHiZ = win.hiZBuffer(),
+            .spIDs = state.ePass == PASS::VISIBILITY ? clRenderRect(win.visibilityBuffer()) : Span2D<i32> {},
+        },
+        .pfnDrawTriangle = kernels().pfnSelectDrawTriangle(state),
+        .pfnShadeTile = kernels().pfnSelectShadeTile(state),
+        .pBlended = vBlended.data(),
+        .pBlendedBins = &blendedBins,
+        .pBlendedDepths = spBlendedDepths.data(),
+        .pfnDrawBlended = kernels().pfnSelectDrawTriangle({
+            .eSampler = state.eSampler,
+            .eDepth = DEPTH::TEST,
+            .eBlend = BLEND::ALPHA,
+            .ePass = PASS::SHADE,
+            .eDepthFormat = state.eDepthFormat,
+        }),
+        .pShadowMap = bShadows ? &shadowMap : nullptr,
+        .pfnShadowTile = kernels().pfnSelectShadowTile(state),
+    };
+
+    const int nTiles = bins.nTilesX * bins.nTilesY;
+    Span<u8> spDrawnTiles {pArena->mallocV<u8>(nTiles), nTiles};
+    arg.pDrawnTiles = spDrawnTiles.data();
+    const int nHelpers = utils::min(app::g_threadPool.nThreads(), nTiles - 1);
+    for (int i = 0; i < nHelpers; ++i)
+        app::g_threadPool.addRetry(rasterTiles, &arg);
+
+    /* main thread takes tiles too */
+    rasterTiles(&arg);
+    app::g_threadPool.wait();
+
+    for (const Outline& outline : vOutlines)
+    {
+        drawOutline(pArena, arg.target, bins, outline);
+        markDrawnTiles(spDrawnTiles, bins, {
+            .minX = outline.rect.minX - OUTLINE_WIDTH,
+            .minY = outline.rect.minY - OUTLINE_WIDTH,
+            .maxX = outline.rect.maxX + OUTLINE_WIDTH,
+            .maxY = outline.rect.maxY + OUTLINE_WIDTH,
+        });
+    }
+
+    if (bPostProcess)
+    {
+        post::draw(clRenderRect(spPresent), arg.target.sp);
+        spDrawnTiles = dilateDrawnTiles(pArena, spDrawnTiles, bins);
+    }
+
+    if (bUpscale)
+        upscale(pArena, win.surfaceBuffer(), clRenderRect(spPresent));
+
+    /* on top of the presented pixels, full size after the upscale */
+    Span<const Rect> spUIRects {};
+    if (control::g_bDrawUI)
+        spUIRects = ui::draw(pArena, bUpscale ? win.surfaceBuffer() : clRenderRect(spPresent));
+
+    if (bUpscale)
+    {
+        /* the whole window changes */
+        win.damageRect(0, 0, win.m_width, win.m_height);
+        s_damageWidth = s_damageHeight = 0;
+    }
+    else
+    {
+        for (const Rect& rect : spUIRects)
+            markDrawnTiles(spDrawnTiles, bins, rect);
+
+        reportDamage(&win, spDrawnTiles, bins, bPostProcess);
+    }
+
+    updateRenderScale(static_cast<f32>(utils::timeNowMS() - timer0));
+}
+
+void
+Renderer::destroy()
+{
+    s_vScaledColor.destroy(StdAllocator::inst());
+    s_vPostColor.destroy(StdAllocator::inst());
+    s_vDrawnTiles.destroy(StdAllocator::inst());
+    s_vShadowDepth.destroy(StdAllocator::inst());
+    s_vShadowHiZ.destroy(StdAllocator::inst());
+    s_shadowMapSize = 0;
+    s_shadowHash = 0;
+    s_vShadowTriangles.destroy(StdAllocator::inst());
+    post::destroy();
+    ui::destroy();
 }
 
 } /* namespace render::sw */
@@ -5,10 +5,50 @@
 namespace render::sw
 {
 
+/* Screen is split into TILE_SIZE x TILE_SIZE tiles.
+ * Must be a multiple of the widest simd row group (16 pixels with AVX-512),
+ * so that aligned row groups never cross into a neighbouring tile. */
+constexpr int TILE_SIZE = 64;
+
+/* Largest pixel extent the 24.8 fixed point edge functions can handle without overflowing i32.
+ * Render targets are no larger than this, anything past the screen but within it is guard band and doesn't get clipped. */
+constexpr int MAX_RASTER_EXTENT = 2000;
+
+/* Depth buffer layout. UNORM formats store depth in [0, 1] as integers and compare it as such,
+ * UNORM24_STENCIL8 packs it as (depth << 8) | stencil. */
+enum class DEPTH_FORMAT : adt::u8 { F32, UNORM16, UNORM24_STENCIL8 };
+
+extern DEPTH_FORMAT g_eDepthFormat;
+
+const char* depthFormatName(const DEPTH_FORMAT eFormat);
+
+/* Target time of Renderer::draw(), the render scale goes down to meet it and back up with headroom. 0 keeps the full size. */
+extern adt::f32 g_frameBudgetMS;
+
+/* Current fraction of the window size per axis that gets rasterized. */
+adt::f32 renderScale();
+
+/* Blend between the two nearest mip levels instead of sampling the nearest one. */
+extern bool g_bTrilinearFiltering;
+
+/* Rasterize triangle ids first and shade every pixel once afterwards, instead of shading at depth test. */
+extern bool g_bVisibilityBuffer;
+
+/* Tonemap, sRGB encode and FXAA pass over the rasterized frame (see post.hh). */
+extern bool g_bPostProcess;
+
+/* Linear multiplier applied before the tonemap curve. */
+extern adt::f32 g_exposure;
+
+/* Directional shadow map from game::g_dirLight, looked up with 2x2 PCF after the opaque pass.
+ * Needs DEPTH_FORMAT::F32 or UNORM24_STENCIL8, UNORM16 depth is too coarse to find the receiver in light space. */
+extern bool g_bShadows;
+
 struct Renderer : public IRenderer
 {
     virtual void init() override;
-    virtual void drawEntities(adt::Arena* pArena) override;
+    virtual void draw(adt::Arena* pArena) override;
+    virtual void destroy() override;
 };
 
 } /* namespace render::sw */
@@ -0,0 +1,492 @@
+#include "swui.hh"
+
+#include "app.hh"
+#include "asset.hh"
+#include "colors.hh"
+#include "control.hh"
+#include "frame.hh"
+#include "kernels.hh"
+#include "sw.hh"
+#include "ttf/Rasterizer.hh"
+#include "ui.hh"
+
+#include "adt/StdAllocator.hh"
+#include "adt/atomic.hh"
+#include "adt/logs.hh"
+
+using namespace adt;
+
+namespace render::sw::ui
+{
+
+/* Glyph cells for '!' to '~', the atlas has the same range. */
+constexpr char FIRST_GLYPH = '!';
+constexpr int N_GLYPHS = '~' - '!' + 1;
+
+/* Atlas glyphs resampled to the on-screen cell size, as 0-256 blend weights, bottom row first like the atlas.
+ * Rows are padded to whole row groups. */
+struct GlyphCache
+{
+    int cellWidth {};
+    int cellHeight {};
+    int stride {};
+    Vec<i32> vCoverage {}; /* N_GLYPHS cells of cellHeight rows, plus one row group of slack for clipped loads */
+
+    Span2D<const i32>
+    glyph(const int glyphI) const
+    {
+        return {&vCoverage[glyphI * stride * cellHeight], cellWidth, cellHeight, stride};
+    }
+};
+
+struct Quad
+{
+    Rect rect {}; /* pixels */
+    ImagePixelRGBA color {};
+};
+
+/* One line of text, drawn in one go per band. */
+struct GlyphRun
+{
+    f32 x {}; /* ui units, each glyph starts on its own rounded pixel */
+    int y {}; /* pixels, bottom row of the line */
+    ImagePixelRGBA color {};
+    StringView sv {};
+};
+
+/* Layout output of one frame, same walk over the widgets as the gl ui. */
+struct Overlay
+{
+    Arena* pArena {};
+    Span2D<ImagePixelRGBA> sp {};
+    f32 unitWidth {}; /* pixels per ui unit */
+    f32 unitHeight {};
+    Vec<Quad> vQuads {};
+    Vec<GlyphRun> vRuns {};
+};
+
+struct DrawBandsArg
+{
+    const Overlay* pOverlay {};
+    int nBands {};
+    atomic::Int atomNextBandI {};
+};
+
+static ::ui::Offset drawArrowList(Overlay* pOverlay, const ::ui::Widget& widget, const ::ui::Entry& entry, const ::ui::Offset off);
+
+static ttf::Rasterizer s_rastLiberation;
+static bool s_bFont = false;
+static GlyphCache s_glyphs;
+
+void
+init()
+{
+    ttf::Font* pFont = asset::searchFont("assets/LiberationMono-Regular.ttf");
+    if (!pFont)
+    {
+        LOG_WARN("no font, no sw ui\n");
+        return;
+    }
+
+    s_rastLiberation.rasterizeAscii(StdAllocator::inst(), pFont, 64.0f);
+    s_bFont = true;
+}
+
+void
+destroy()
+{
+    if (s_bFont) s_rastLiberation.destroy(StdAllocator::inst());
+    s_bFont = false;
+
+    s_glyphs.vCoverage.destroy(StdAllocator::inst());
+    s_glyphs = {};
+}
+
+/* Box filter over the part of the atlas cell each pixel covers, only redone when the cell size changes. */
+static void
+updateGlyphCache(const int cellWidth, const int cellHeight)
+{
+    if (cellWidth == s_glyphs.cellWidth && cellHeight == s_glyphs.cellHeight) return;
+
+    s_glyphs.cellWidth = cellWidth;
+    s_glyphs.cellHeight = cellHeight;
+    s_glyphs.stride = (cellWidth + MAX_LANE_WIDTH - 1) & ~(MAX_LANE_WIDTH - 1);
+
+    const isize size = N_GLYPHS * s_glyphs.stride * cellHeight + MAX_LANE_WIDTH;
+    s_glyphs.vCoverage.setSize(StdAllocator::inst(), size);
+    cpu::kernels().pfnFillI32({s_glyphs.vCoverage.data(), size}, 0);
+
+    const Span2D<const u8> spAtlas = s_rastLiberation.m_altas.spanMono();
+    const int atlasCellWidth = static_cast<int>(s_rastLiberation.m_scale * ttf::Rasterizer::X_STEP);
+    const int atlasCellHeight = static_cast<int>(s_rastLiberation.m_scale);
+
+    for (int glyphI = 0; glyphI < N_GLYPHS; ++glyphI)
+    {
+        const MapResult fUV = s_rastLiberation.m_mapCodeToUV.search(FIRST_GLYPH + glyphI);
+        if (!fUV) continue;
+
+        const Pair<i16, i16> uv = fUV.value();
+        Span2D<i32> spGlyph {&s_glyphs.vCoverage[glyphI * s_glyphs.stride * cellHeight], cellWidth, cellHeight, s_glyphs.stride};
+
+        for (int y = 0; y < cellHeight; ++y)
+        {
+            const int firstY = y * atlasCellHeight / cellHeight;
+            const int endY = utils::max(firstY + 1, (y + 1) * atlasCellHeight / cellHeight);
+
+            for (int x = 0; x < cellWidth; ++x)
+            {
+                const int firstX = x * atlasCellWidth / cellWidth;
+                const int endX = utils::max(firstX + 1, (x + 1) * atlasCellWidth / cellWidth);
+
+                int sum = 0;
+                for (int atlasY = firstY; atlasY < endY; ++atlasY)
+                {
+                    for (int atlasX = firstX; atlasX < endX; ++atlasX)
+                        sum += spAtlas(uv.first + atlasX, uv.second + atlasY);
+                }
+
+                const int coverage = sum / ((endX - firstX) * (endY - firstY));
+                spGlyph(x, y) = coverage + (coverage >> 7);
+            }
+        }
+    }
+}
+
+static int
+pixelX(const Overlay& overlay, const f32 x)
+{
+    return static_cast<int>(std::round(x * overlay.unitWidth));
+}
+
+/* ui y goes down from the top, the surface starts at the bottom row. */
+static int
+pixelY(const Overlay& overlay, const f32 y)
+{
+    return overlay.sp.height() - static_cast<int>(std::round(y * overlay.unitHeight));
+}
+
+static void
+pushQuad(Overlay* pOverlay, const f32 x, const f32 y, const f32 width, const f32 height, const math::V4 color)
+{
+    pOverlay->vQuads.push(pOverlay->pArena, {
+        .rect {
+            .minX = pixelX(*pOverlay, x),
+            .minY = pixelY(*pOverlay, y + height),
+            .maxX = pixelX(*pOverlay, x + width) - 1,
+            .maxY = pixelY(*pOverlay, y) - 1,
+        },
+        .color {.data = colors::V4ToRGBA(color)},
+    });
+}
+
+/* One run per line, returns the size like the gl version. */
+static ::ui::Offset
+pushText(Overlay* pOverlay, const f32 x, const f32 y, const StringView sv, const math::V4 color)
+{
+    const ImagePixelRGBA rgba {.data = colors::V4ToRGBA(color)};
+
+    f32 lineY = y;
+    isize lineStartI = 0;
+    for (isize i = 0; i <= sv.size(); ++i)
+    {
+        if (i < sv.size() && sv[i] != '\n') continue;
+
+        if (i > lineStartI)
+        {
+            pOverlay->vRuns.push(pOverlay->pArena, {
+                .x = x,
+                .y = pixelY(*pOverlay, lineY) - s_glyphs.cellHeight,
+                .color = rgba,
+                .sv = {const_cast<char*>(sv.data()) + lineStartI, i - lineStartI},
+            });
+        }
+
+        lineStartI = i + 1;
+        lineY += 1.0f;
+    }
+
+    return {static_cast<int>(sv.size()), 1};
+}
+
+static ::ui::Offset
+drawText(Overlay* pOverlay, const ::ui::Widget& widget, const StringView sv, const math::V4 color, const ::ui::Offset off)
+{
+    return pushText(pOverlay, widget.x + off.x, widget.y + off.y, sv, color);
+}
+
+static ::ui::Offset
+drawMenu(Overlay* pOverlay, const ::ui::Widget& widget, const ::ui::Entry& entry, const ::ui::Offset off)
+{
+    ADT_ASSERT(entry.m_eType == ::ui::Entry::TYPE::MENU, "");
+
+    auto& menu = entry.m_menu;
+
+    ::ui::Offset thisOff {0, 0};
+
+    {
+        auto xy = drawText(pOverlay, widget, menu.sfName, menu.color, off);
+        thisOff.x = utils::max(xy.x, thisOff.x);
+        thisOff.y += xy.y;
+    }
+
+    for (const ::ui::Entry& child : menu.vEntries)
+    {
+        const isize idx = menu.vEntries.idx(&child);
+        const math::V4 col = idx == menu.selectedI ? menu.selColor : menu.color;
+        const ::ui::Offset childOff {off.x + 2, off.y + thisOff.y};
+
+        ::ui::Offset xy {};
+
+        switch (child.m_eType)
+        {
+            case ::ui::Entry::TYPE::TEXT: xy = drawText(pOverlay, widget, child.m_text.sfName, col, childOff); break;
+            case ::ui::Entry::TYPE::ARROW_LIST: xy = drawArrowList(pOverlay, widget, child, childOff); break;
+            case ::ui::Entry::TYPE::MENU: xy = drawMenu(pOverlay, widget, child, childOff); break;
+        }
+
+        /* +2 since children are off by 2 */
+        thisOff.x = utils::max(xy.x + 2, thisOff.x);
+        thisOff.y += xy.y;
+    }
+
+    return thisOff;
+}
+
+static ::ui::Offset
+drawArrowList(Overlay* pOverlay, const ::ui::Widget& widget, const ::ui::Entry& entry, const ::ui::Offset off)
+{
+    ADT_ASSERT(entry.m_eType == ::ui::Entry::TYPE::ARROW_LIST, "");
+
+    auto& arrowList = entry.m_arrowList;
+
+    ::ui::Offset thisOff {0, 0};
+
+    {
+        drawText(pOverlay, widget, "<", arrowList.arrowColor, off);
+        auto xy = drawText(pOverlay, widget, arrowList.sfName, arrowList.color, {off.x + 1, off.y});
+        drawText(pOverlay, widget, ">", arrowList.arrowColor, {off.x + xy.x + 1, off.y});
+
+        thisOff.x = utils::max(thisOff.x, xy.x + 2);
+        ++thisOff.y;
+    }
+
+    if (arrowList.vEntries.size() > 0)
+    {
+        const auto& sel = arrowList.vEntries[arrowList.selectedI];
+        switch (sel.m_eType)
+        {
+            case ::ui::Entry::TYPE::TEXT:
+            {
+                auto xy = drawText(pOverlay, widget, sel.m_text.sfName, sel.m_text.color, {off.x + 2, off.y + thisOff.y});
+                thisOff.x = utils::max(thisOff.x, xy.x);
+                thisOff.y += xy.y;
+            }
+            break;
+
+            case ::ui::Entry::TYPE::MENU:
+            {
+                auto xy = drawMenu(pOverlay, widget, sel, {off.x, off.y + thisOff.y});
+                thisOff.x = utils::max(thisOff.x, xy.x);
+                thisOff.y += xy.y;
+            }
+            break;
+
+            case ::ui::Entry::TYPE::ARROW_LIST:
+            break;
+        }
+    }
+
+    return thisOff;
+}
+
+static void
+drawWidget(Overlay* pOverlay, ::ui::Widget* pWidget)
+{
+    ::ui::Offset thisOff {0, 0};
+
+    if (bool(pWidget->eFlags & ::ui::Widget::FLAGS::TITLE))
+    {
+        auto xy = drawText(pOverlay, *pWidget, pWidget->sfTitle, V4From(colors::WHITE, 0.75f), {0, 0});
+        thisOff.x = utils::max(thisOff.x, xy.x);
+        thisOff.y += xy.y;
+    }
+
+    for (const auto& entry : pWidget->vEntries)
+    {
+        ::ui::Offset xy {};
+
+        switch (entry.m_eType)
+        {
+            case ::ui::Entry::TYPE::ARROW_LIST: xy = drawArrowList(pOverlay, *pWidget, entry, {0, thisOff.y}); break;
+            case ::ui::Entry::TYPE::TEXT: xy = drawText(pOverlay, *pWidget, entry.m_text.sfName, entry.m_text.color, {0, thisOff.y}); break;
+            case ::ui::Entry::TYPE::MENU: xy = drawMenu(pOverlay, *pWidget, entry, {0, thisOff.y}); break;
+        }
+
+        thisOff.x = utils::max(thisOff.x, xy.x);
+        thisOff.y += xy.y;
+    }
+
+    pWidget->priv.grabWidth = thisOff.x;
+    pWidget->priv.grabHeight = thisOff.y;
+
+    /* bg rectangle */
+    if (pWidget->priv.grabHeight > 0 && pWidget->priv.grabWidth > 0)
+    {
+        pushQuad(pOverlay,
+            pWidget->x - pWidget->border,
+            pWidget->y - pWidget->border,
+            pWidget->priv.grabWidth + pWidget->border*2,
+            pWidget->priv.grabHeight + pWidget->border*2,
+            pWidget->bgColor
+        );
+    }
+}
+
+/* Bands of TILE_SIZE rows, each one blends the quads first and the text over them.
+ * Every row belongs to one band, so the row group stores past a glyph never race. */
+static THREAD_STATUS
+drawBands(void* pArg)
+{
+    auto& arg = *static_cast<DrawBandsArg*>(pArg);
+    const Overlay& overlay = *arg.pOverlay;
+    Span2D<ImagePixelRGBA> sp = overlay.sp;
+    const int width = sp.width();
+    const int cellWidth = s_glyphs.cellWidth;
+    const int cellHeight = s_glyphs.cellHeight;
+
+    int bandI;
+    while ((bandI = arg.atomNextBandI.fetchAdd(1, atomic::ORDER::RELAXED)) < arg.nBands)
+    {
+        const int minY = bandI * TILE_SIZE;
+        const int maxY = utils::min(minY + TILE_SIZE, static_cast<int>(sp.height())) - 1;
+
+        for (const Quad& quad : overlay.vQuads)
+        {
+            const int minX = utils::max(quad.rect.minX, 0);
+            const int maxX = utils::min(quad.rect.maxX, width - 1);
+            const int firstY = utils::max(quad.rect.minY, minY);
+            const int lastY = utils::min(quad.rect.maxY, maxY);
+            if (minX > maxX || firstY > lastY) continue;
+
+            kernels().pfnBlendCoverage({&sp(minX, firstY), maxX - minX + 1, lastY - firstY + 1, sp.stride()}, {}, quad.color);
+        }
+
+        for (const GlyphRun& run : overlay.vRuns)
+        {
+            const int firstRow = utils::max(minY - run.y, 0);
+            const int endRow = utils::min(maxY - run.y + 1, cellHeight);
+            if (firstRow >= endRow) continue;
+
+            for (isize charI = 0; charI < run.sv.size(); ++charI)
+            {
+                const int glyphI = run.sv[charI] - FIRST_GLYPH;
+                if (glyphI < 0 || glyphI >= N_GLYPHS) continue; /* spaces */
+
+                const int x = pixelX(overlay, run.x + static_cast<f32>(charI));
+                const int firstCol = utils::max(-x, 0);
+                const int endCol = utils::min(cellWidth, width - x);
+                if (firstCol >= endCol) continue;
+
+                const Span2D<const i32> spGlyph = s_glyphs.glyph(glyphI);
+                kernels().pfnBlendCoverage(
+                    {&sp(x + firstCol, run.y + firstRow), endCol - firstCol, endRow - firstRow, sp.stride()},
+                    {&spGlyph(firstCol, firstRow), endCol - firstCol, endRow - firstRow, spGlyph.stride()},
+                    run.color
+                );
+            }
+        }
+    }
+
+    return THREAD_STATUS(0);
+}
+
+Span<const Rect>
+draw(Arena* pArena, Span2D<ImagePixelRGBA> sp)
+{
+    if (!s_bFont || sp.width() <= 0 || sp.height() <= 0) return {};
+
+    Overlay overlay {
+        .pArena = pArena,
+        .sp = sp,
+        .unitWidth = static_cast<f32>(sp.width()) / ::ui::WIDTH,
+        .unitHeight = static_cast<f32>(sp.height()) / ::ui::HEIGHT,
+        .vQuads {pArena, 1 << 4},
+        .vRuns {pArena, 1 << 6},
+    };
+
+    updateGlyphCache(
+        utils::max(static_cast<int>(std::round(overlay.unitWidth)), 1),
+        utils::max(static_cast<int>(std::round(overlay.unitHeight)), 1)
+    );
+
+    /* fps */
+    pushText(&overlay, 0.0f, 0.0f, frame::g_sfFpsStatus, V4From(colors::GREEN, 0.75f));
+
+    /* info */
+    {
+        char* pBuff = pArena->zallocV<char>(1 << 9);
+        isize n = print::toSpan({pBuff, 1 << 9},
+            "F: toggle fullscreen ({})\n"
+            "V: toggle VSync ({})\n"
+            "R: lock/unlock mouse ({})\n"
+            "P: pause/unpause simulation ({})\n"
+            "H: draw UI ({})\n"
+            "Q/Escape: quit\n"
+            ,
+            app::windowInst().m_bFullscreen ? "on" : "off",
+            app::windowInst().m_swapInterval == 1 ? "on" : "off",
+            app::windowInst().m_bPointerRelativeMode ? "locked" : "unlocked",
+            control::g_bPauseSimulation ? "paused" : "unpaused",
+            control::g_bDrawUI
+        );
+
+        StringView sv = {pBuff, n};
+
+        int nLines = 0;
+        for (auto ch : sv) if (ch == '\n') ++nLines;
+
+        pushText(&overlay, 0.0f, ::ui::HEIGHT - static_cast<f32>(nLines), sv, V4From(colors::WHITE, 0.75f));
+    }
+
+    for (::ui::Widget& widget : ::ui::g_poolWidgets)
+    {
+        if (bool(widget.eFlags & ::ui::Widget::FLAGS::NO_DRAW))
+            continue;
+
+        drawWidget(&overlay, &widget);
+    }
+
+    DrawBandsArg arg {
+        .pOverlay = &overlay,
+        .nBands = (static_cast<int>(sp.height()) + TILE_SIZE - 1) / TILE_SIZE,
+    };
+
+    const int nHelpers = utils::min(app::g_threadPool.nThreads(), arg.nBands - 1);
+    for (int i = 0; i < nHelpers; ++i)
+        app::g_threadPool.addRetry(drawBands, &arg);
+
+    /* main thread takes bands too */
+    drawBands(&arg);
+    app::g_threadPool.wait();
+
+    const isize nRects = overlay.vQuads.size() + overlay.vRuns.size();
+    Span<Rect> spRects {pArena->mallocV<Rect>(utils::max(nRects, isize(1))), nRects};
+
+    isize rectI = 0;
+    for (const Quad& quad : overlay.vQuads)
+        spRects[rectI++] = quad.rect;
+
+    for (const GlyphRun& run : overlay.vRuns)
+    {
+        spRects[rectI++] = {
+            .minX = pixelX(overlay, run.x),
+            .minY = run.y,
+            .maxX = pixelX(overlay, run.x + static_cast<f32>(run.sv.size() - 1)) + s_glyphs.cellWidth - 1,
+            .maxY = run.y + s_glyphs.cellHeight - 1,
+        };
+    }
+
+    return spRects;
+}
+
+} /* namespace render::sw::ui */
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Image.hh"
+
+#include "adt/Span.hh"
+
+namespace adt
+{
+    struct Arena;
+} /* namespace adt */
+
+namespace render::sw
+{
+    struct Rect;
+} /* namespace render::sw */
+
+namespace render::sw::ui
+{
+
+void init();
+/* Composites the hud and ::ui widgets over sp (bottom row first), after the 3d pass.
+ * Returns the pixel rects it drew over (unclipped, in pArena), for damage tracking. */
+adt::Span<const Rect> draw(adt::Arena* pArena, adt::Span2D<ImagePixelRGBA> sp);
+void destroy();
+
+} /* namespace render::sw::ui */